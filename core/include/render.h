@@ -0,0 +1,123 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "game.h"
+#include "perfect_clear.h"
+#include "sandbox.h"
+
+// Which part of a field is on screen: the cell under the top-left corner of the viewport and how many
+// pixels a cell takes. Panning moves x and y, zooming changes cellSize. Drawing only visits the rows
+// and columns under the viewport, so a frame costs what is on screen rather than what the field holds.
+struct Camera
+{
+    float x, y;
+    float cellSize;
+    SDL_Rect viewport;
+};
+
+const float MIN_CELL_SIZE = 0.25f;
+const float MAX_CELL_SIZE = 64.0f;
+
+// Cells of a field under the viewport, clamped to the field
+struct VisibleCells
+{
+    int x0, y0;
+    int x1, y1; // Inclusive
+};
+
+// Rectangles of one color, submitted to the renderer in a single call
+struct RectBatch
+{
+    std::vector<SDL_FRect> rects;
+    uint64_t submitted; // Rectangles over every flush, for frame statistics
+};
+
+// Frames a whole columns x rows board in area with the largest whole-pixel cells that fit, centered
+Camera fitCamera(int columns, int rows, const SDL_Rect& area);
+void centerCamera(Camera& camera, float x, float y);
+// Scales around the screen point (screenX, screenY), which stays over the same cell
+void zoomCamera(Camera& camera, float factor, int screenX, int screenY);
+bool getVisibleCells(const Camera& camera, int columns, int rows, VisibleCells& cells);
+SDL_FRect getCellRect(const Camera& camera, int x, int y, int columns = 1);
+
+// Adds one rectangle per run of set bits; bit i is column firstColumn + i
+void addRowSpans(RectBatch& batch, const Camera& camera, uint64_t bits, int firstColumn, int y);
+void flushRects(SDL_Renderer* renderer, RectBatch& batch, Color color);
+
+// Cell styles drawn once at startup into one texture: a bevelled tile for every palette entry, then a
+// ghost tile for each. Tiles are ATLAS_TILE_SIZE square with a one pixel gutter repeating their edge,
+// so filtering never pulls in a neighbour.
+const int ATLAS_TILE_SIZE = 32;
+const int ATLAS_TILE_STRIDE = ATLAS_TILE_SIZE + 2;
+const int ATLAS_GHOST_TILES = PALETTE_SIZE; // First ghost tile
+const int ATLAS_TILE_COUNT = 2 * PALETTE_SIZE;
+
+struct CellAtlas
+{
+    SDL_Texture* texture;
+};
+
+// Textured cells for one SDL_RenderGeometry call, drawn in the order they were added
+struct SpriteBatch
+{
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    uint64_t submitted; // Cells over every flush, for frame statistics
+};
+
+bool createCellAtlas(SDL_Renderer* renderer, CellAtlas& atlas);
+void destroyCellAtlas(CellAtlas& atlas);
+
+void addSprite(SpriteBatch& batch, const SDL_FRect& rect, int tile);
+void flushSprites(SDL_Renderer* renderer, SpriteBatch& batch, const CellAtlas& atlas);
+
+// These only queue cells; nothing is drawn until flushSprites
+template <int Width, int Height>
+void addBoardSprites(SpriteBatch& batch, const BasicBoard<Width, Height>& board, const Camera& camera);
+void addTetrominoSprites(SpriteBatch& batch, const Tetromino& tetromino, const Camera& camera, bool isGhost = false);
+template <int Width, int Height>
+void addPieceSprites(SpriteBatch& batch, const BasicGame<Width, Height>& game, const Camera& camera); // Ghost, then the piece
+
+void renderPerfectClearHint(SDL_Renderer* renderer, const PerfectClearSolution& solution, const Camera& camera);
+
+// Upcoming pieces, each centered in a slot of QUEUE_SLOT_COLUMNS x QUEUE_SLOT_ROWS cells, top to bottom
+const int QUEUE_SLOT_COLUMNS = 4;
+const int QUEUE_SLOT_ROWS = 3;
+void addQueueSprites(SpriteBatch& batch, const int* queue, int count, const Camera& camera);
+
+// Empty well behind a board: a dark field, faint grid lines and a border
+void renderWell(SDL_Renderer* renderer, int columns, int rows, const Camera& camera, RectBatch& batch);
+void renderPanelFrame(SDL_Renderer* renderer, const SDL_Rect& rect);
+
+// One layer of the frame, kept in a texture the size of the largest window and drawn again only when
+// the key it was drawn from changes. Static layers keep one key for good, semi-static ones key on the
+// values they show, and whatever moves every frame is drawn straight to the screen on top.
+struct Layer
+{
+    SDL_Texture* texture;
+    uint64_t key;
+    bool isValid; // Cleared when the renderer loses its targets
+    uint64_t redraws;
+};
+
+bool createLayer(SDL_Renderer* renderer, Layer& layer, int width, int height);
+void destroyLayer(Layer& layer);
+// When the layer holds something other than key, points rendering at it, clears it and returns true;
+// draw its contents and call endLayer. Returns false if the layer is already current.
+bool beginLayer(SDL_Renderer* renderer, Layer& layer, uint64_t key);
+void endLayer(SDL_Renderer* renderer);
+void drawLayer(SDL_Renderer* renderer, const Layer& layer);
+
+template <int Width, int Height>
+uint64_t getBoardKey(const BasicBoard<Width, Height>& board); // Changes with any cell or its color
+uint64_t getQueueKey(const int* queue, int count);
+uint64_t mixKey(uint64_t key, uint64_t value); // Folds one more shown value into a key
+
+// Red bar up the right edge of the default board, one cell per garbage line about to rise
+void renderGarbageMeter(SDL_Renderer* renderer, int pending, const Camera& camera);
+
+// Walks the chunk grid under the viewport only; empty chunks cost one index read. Sandbox fields keep
+// no colors, so cells are drawn as flat white spans, which also stays cheap when zoomed far out.
+void renderSandbox(SDL_Renderer* renderer, const SandboxBoard& board, const Camera& camera, RectBatch& batch);
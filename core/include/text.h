@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "game.h"
+
+// 8x8 bitmap text for the HUD. The glyphs are baked once into a small atlas texture, strings are laid
+// out once into quads and kept as runs, and every run queued for a frame goes out in one draw call.
+
+const int GLYPH_SIZE = 8;
+const int GLYPH_FIRST = ' ';
+const int GLYPH_COUNT = 64; // ' ' to '_'; lowercase is drawn as uppercase and anything else as '?'
+const int GLYPH_ATLAS_COLUMNS = 16;
+const int TEXT_LINE_HEIGHT = GLYPH_SIZE + 2;
+const int TEXT_RUN_CAPACITY = 64; // Including the terminator; longer text is cut off
+
+struct GlyphAtlas
+{
+    SDL_Texture* texture;
+};
+
+// A string laid out at a fixed place. Its quads are kept, and only built again when the text changes.
+struct TextRun
+{
+    char text[TEXT_RUN_CAPACITY];
+    float x, y;
+    int scale; // Screen pixels per font pixel
+    Color color;
+    std::vector<SDL_Vertex> vertices; // Two triangles per visible glyph
+    uint64_t layouts;
+};
+
+// Quads of every run queued since the last flush
+struct TextBatch
+{
+    std::vector<SDL_Vertex> vertices;
+    uint64_t submitted; // Glyphs over every flush, for frame statistics
+};
+
+bool createGlyphAtlas(SDL_Renderer* renderer, GlyphAtlas& atlas);
+void destroyGlyphAtlas(GlyphAtlas& atlas);
+
+TextRun createTextRun(float x, float y, int scale, Color color, const char* text = "");
+// Returns whether the text differed and the run was laid out again
+bool setText(TextRun& run, const char* text);
+
+void addTextRun(TextBatch& batch, const TextRun& run);
+void flushText(SDL_Renderer* renderer, TextBatch& batch, const GlyphAtlas& atlas);
@@ -1,201 +1,161 @@
 #define SDL_MAIN_HANDLED
 
 #include <SDL2/SDL.h>
-#include <vector>
+#include <cstdio>
 #include <ctime>
-#include <cstdlib>
+#include <deque>
+#include <thread>
+
+#include "ai_worker.h"
+#include "game.h"
+#include "hint_worker.h"
+#include "opening_book.h"
+#include "pathfinder.h"
+#include "perfect_clear.h"
+#include "render.h"
+#include "replay.h"
+#include "rollback.h"
+#include "sandbox.h"
+#include "text.h"
 
 const int SCREEN_WIDTH = 300;
 const int SCREEN_HEIGHT = 600;
-const int BLOCK_SIZE = 30;
 
-const int BOARD_WIDTH = SCREEN_WIDTH / BLOCK_SIZE;
-const int BOARD_HEIGHT = SCREEN_HEIGHT / BLOCK_SIZE;
-
-struct Block
+// The next queue and the stats sit in a panel right of the board; versus replaces it with the second board
+const int QUEUE_PANEL_WIDTH = 100;
+const int WINDOW_WIDTH = SCREEN_WIDTH + QUEUE_PANEL_WIDTH;
+const SDL_Rect QUEUE_FRAME = { SCREEN_WIDTH + 5, 20, QUEUE_PANEL_WIDTH - 10, 20 * QUEUE_SLOT_ROWS * NEXT_QUEUE_SIZE + 10 };
+const int STATS_Y = QUEUE_FRAME.y + QUEUE_FRAME.h + 12;
+const Color LABEL_COLOR = { 160, 160, 160, 255 };
+const Color VALUE_COLOR = { 255, 255, 255, 255 };
+
+// Layers of the frame, bottom to top. Each is drawn again only when what it shows changes; the falling
+// pieces go on top, straight to the screen, every frame.
+enum LayerId
 {
-    int x, y;
+    LAYER_BACKGROUND, // Wells, panel frames and labels, keyed on the mode
+    LAYER_BOARD,
+    LAYER_OPPONENT_BOARD,
+    LAYER_HUD, // Next queue and stats, keyed on their values
+    LAYER_COUNT
 };
 
-struct Tetromino
-{
-    std::vector<Block> blocks;
-    SDL_Color color;
-    int pivotIndex; // Index of the pivot block for rotation
-};
+const char* LAYER_NAMES[LAYER_COUNT] = { "background", "board", "opponent", "hud" };
+const int LAYER_WIDTH = SCREEN_WIDTH * 2 > WINDOW_WIDTH ? SCREEN_WIDTH * 2 : WINDOW_WIDTH; // The widest the window gets
 
-Tetromino createTetromino()
-{
-    Tetromino tetromino;
-    int type = rand() % 5;
-    tetromino.color = { (Uint8)(rand() % 256), (Uint8)(rand() % 256), (Uint8)(rand() % 256), 255 };
+// The AI plays no faster than this, and gives its current best move once it has thought this long
+const Uint32 AI_MOVE_DELAY = 150;
+const int AI_THINK_LIMIT = 1000;
 
-    switch (type)
-    {
-    case 0: // Line
-        tetromino.blocks = { {4, 0}, {5, 0}, {6, 0}, {7, 0} };
-        tetromino.pivotIndex = 1;
-        break;
-    case 1: // Square
-        tetromino.blocks = { {4, 0}, {5, 0}, {4, 1}, {5, 1} };
-        tetromino.pivotIndex = -1; // No rotation for square
-        break;
-    case 2: // T-shape
-        tetromino.blocks = { {4, 0}, {5, 0}, {6, 0}, {5, 1} };
-        tetromino.pivotIndex = 1;
-        break;
-    case 3: // L-shape
-        tetromino.blocks = { {4, 0}, {5, 0}, {6, 0}, {4, 1} };
-        tetromino.pivotIndex = 1;
-        break;
-    case 4: // Reverse L-shape
-        tetromino.blocks = { {4, 0}, {5, 0}, {6, 0}, {6, 1} };
-        tetromino.pivotIndex = 1;
-        break;
-    }
+const char* DIFFICULTY_NAMES[DIFFICULTY_COUNT] = { "easy", "normal", "hard" };
 
-    return tetromino;
-}
+// Versus against the computer, toggled with V. Each side runs its own rollback session and only hears
+// the other's inputs VERSUS_LATENCY later, as it would over a network.
+const int VERSUS_TICK_RATE = 60;
+const Uint32 VERSUS_LATENCY = 100;
+const int VERSUS_OPPONENT_TICKS = 6; // The opponent presses at most once every this many ticks
 
-bool checkCollision(const Tetromino& tetromino, const std::vector<std::vector<int>>& board)
-{
-    for (const Block& block : tetromino.blocks)
-    {
-        if (block.x < 0 || block.x >= BOARD_WIDTH || block.y >= BOARD_HEIGHT)
-            return true;
-        if (block.y >= 0 && board[block.y][block.x])
-            return true;
-    }
-    return false;
-}
+// Sandbox, toggled with B: one huge field in chunked storage. The camera follows the piece until it is
+// panned with WASD, and F brings it back; the mouse wheel and +/- zoom.
+const int SANDBOX_WIDTH = 4096;
+const int SANDBOX_HEIGHT = 4096;
+const int SANDBOX_VIEW_COLUMNS = 20; // At the starting zoom
+const int SANDBOX_VIEW_ROWS = 40;
+const float SANDBOX_ZOOM_STEP = 1.25f;
 
-void placeTetromino(const Tetromino& tetromino, std::vector<std::vector<int>>& board)
+// Moves on their way to the other side, with the sender's checksum of its latest final match
+struct SentInput
 {
-    for (const Block& block : tetromino.blocks)
-    {
-        if (block.y >= 0)
-            board[block.y][block.x] = 1;
-    }
-}
+    uint32_t tick;
+    uint8_t moves;
+    uint32_t checksumTicks;
+    uint64_t checksum;
+    Uint32 arrival;
+};
 
-void clearFullLines(std::vector<std::vector<int>>& board)
+// The opponent's press for this tick: the next step towards where the heuristic wants the piece
+uint8_t chooseOpponentMoves(const Game& game, Evaluator& evaluator, Tetromino& target, int& targetPieces)
 {
-    for (int y = BOARD_HEIGHT - 1; y >= 0; --y)
-    {
-        bool isFull = true;
-        for (int x = 0; x < BOARD_WIDTH; ++x)
-        {
-            if (board[y][x] == 0)
-            {
-                isFull = false;
-                break;
-            }
-        }
+    if (game.isGameOver)
+        return 0;
 
-        if (isFull)
-        {
-            // Clear the line and move everything above down
-            for (int row = y; row > 0; --row)
-            {
-                for (int x = 0; x < BOARD_WIDTH; ++x)
-                {
-                    board[row][x] = board[row - 1][x];
-                }
-            }
-
-            // Clear the top line
-            for (int x = 0; x < BOARD_WIDTH; ++x)
-            {
-                board[0][x] = 0;
-            }
-
-            // Since we cleared a line, we need to check the same row again
-            ++y;
-        }
+    Reachability reachability;
+    findReachable(game.board, game.current, reachability);
+    if (targetPieces != game.piecesPlaced || !isReachable(reachability, target))
+    {
+        Placement placement;
+        targetPieces = game.piecesPlaced;
+        if (!choosePlacement(game, evaluator, placement) || !findPlacement(game, placement, target) || !isReachable(reachability, target))
+            return 1 << MOVE_HARD_DROP;
     }
+
+    // Once there, gravity locks it
+    Move path[MAX_PATH_LENGTH];
+    int length = findPath(reachability, target, path);
+    return length > 0 ? (uint8_t)(1 << path[0]) : 0;
 }
 
-void renderBoard(SDL_Renderer* renderer, const std::vector<std::vector<int>>& board)
+SentInput makeSentInput(const RollbackSession& session, uint8_t moves, Uint32 now)
 {
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-    for (int y = 0; y < BOARD_HEIGHT; ++y)
-    {
-        for (int x = 0; x < BOARD_WIDTH; ++x)
-        {
-            if (board[y][x])
-            {
-                SDL_Rect rect = { x * BLOCK_SIZE, y * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-                SDL_RenderFillRect(renderer, &rect);
-            }
-        }
-    }
+    SentInput input = { session.match.tick - 1, moves, getConfirmedTicks(session), 0, now + VERSUS_LATENCY };
+    Match match;
+    if (getMatchAt(session, input.checksumTicks, match))
+        input.checksum = match.checksum;
+    return input;
 }
 
-void dropTetromino(Tetromino& tetromino, const std::vector<std::vector<int>>& board)
+// Hands over every input that has arrived by now and that the session can take. Returns false with
+// the tick count of the first disagreement if the sender's checksum differs from the session's.
+bool deliverInputs(std::deque<SentInput>& inputs, RollbackSession& session, int player, Uint32 now, uint32_t& desyncTicks)
 {
-    Tetromino droppedTetromino = tetromino;
-    while (!checkCollision(droppedTetromino, board))
+    bool isInSync = true;
+    while (!inputs.empty() && inputs.front().arrival <= now && addRemoteInput(session, player, inputs.front().tick, inputs.front().moves))
     {
-        for (auto& block : droppedTetromino.blocks)
+        const SentInput& input = inputs.front();
+        if (!checkRemoteChecksum(session, input.checksumTicks, input.checksum) && isInSync)
         {
-            block.y++;
+            desyncTicks = input.checksumTicks;
+            isInSync = false;
         }
+        inputs.pop_front();
     }
-    // Move back up one step to avoid collision
-    for (auto& block : droppedTetromino.blocks)
-    {
-        block.y--;
-    }
-    tetromino = droppedTetromino;
+    return isInSync;
 }
 
-void renderTetromino(SDL_Renderer* renderer, const Tetromino& tetromino)
+// Both sides live in this process, so both snapshots go in one file
+void writeDesyncReport(const RollbackSession& local, const RollbackSession& remote, uint32_t ticks)
 {
-    SDL_SetRenderDrawColor(renderer, tetromino.color.r, tetromino.color.g, tetromino.color.b, tetromino.color.a);
-    for (const Block& block : tetromino.blocks)
+    char path[64];
+    snprintf(path, sizeof(path), "desync_%u.txt", ticks);
+    FILE* file = fopen(path, "w");
+    if (file == nullptr)
+        return;
+
+    Match match;
+    const RollbackSession* sides[2] = { &local, &remote };
+    for (const RollbackSession* side : sides)
     {
-        SDL_Rect rect = { block.x * BLOCK_SIZE, block.y * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-        SDL_RenderFillRect(renderer, &rect);
+        fprintf(file, "player %d's view\n", side->localPlayer);
+        if (getMatchAt(*side, ticks, match))
+            dumpMatch(file, match);
+        else
+            fprintf(file, "no longer kept\n");
+        fprintf(file, "\n");
     }
+    fclose(file);
+    SDL_Log("Versus desync after tick %u, snapshots written to %s", ticks, path);
 }
 
-void renderGhostTetromino(SDL_Renderer* renderer, Tetromino tetromino, const std::vector<std::vector<int>>& board)
-{
-    // Drop the tetromino to the expected landing position
-    dropTetromino(tetromino, board);
-
-    // Render the ghost tetromino with a semi-transparent color
-    SDL_SetRenderDrawColor(renderer, tetromino.color.r / 2, tetromino.color.g / 2, tetromino.color.b / 2, tetromino.color.a);
-    for (const Block& block : tetromino.blocks)
-    {
-        SDL_Rect rect = { block.x * BLOCK_SIZE, block.y * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE };
-        SDL_RenderFillRect(renderer, &rect);
-    }
-}
-
-void rotateTetromino(Tetromino& tetromino)
+int main(int argc, char* argv[])
 {
-    if (tetromino.pivotIndex == -1)
-        return; // No rotation for square
-
-    Block pivot = tetromino.blocks[tetromino.pivotIndex];
-    for (auto& block : tetromino.blocks)
+    // Kicks can be picked on the command line: none, srs (the default) or ars
+    RotationSystem rotationSystem = ROTATION_SRS;
+    if (argc > 1 && !findRotationSystem(argv[1], rotationSystem))
     {
-        int relativeX = block.x - pivot.x;
-        int relativeY = block.y - pivot.y;
-
-        // Apply 90-degree rotation transformation
-        int rotatedX = -relativeY;
-        int rotatedY = relativeX;
-
-        block.x = pivot.x + rotatedX;
-        block.y = pivot.y + rotatedY;
+        SDL_Log("Unknown rotation system %s, expected none, srs or ars", argv[1]);
+        return 1;
     }
-}
-
-int main(int argc, char* argv[])
-{
-    srand(static_cast<unsigned int>(time(0)));
+    setRotationSystem(rotationSystem);
 
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -205,7 +165,7 @@ int main(int argc, char* argv[])
     }
 
     // Create a window
-    SDL_Window* window = SDL_CreateWindow("Simple Tetris Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    SDL_Window* window = SDL_CreateWindow("Simple Tetris Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     if (window == nullptr)
     {
         SDL_Log("Window could not be created! SDL_Error: %s", SDL_GetError());
@@ -214,7 +174,7 @@ int main(int argc, char* argv[])
     }
 
     // Create a renderer
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
     if (renderer == nullptr)
     {
         SDL_Log("Renderer could not be created! SDL_Error: %s", SDL_GetError());
@@ -223,8 +183,114 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    std::vector<std::vector<int>> board(BOARD_HEIGHT, std::vector<int>(BOARD_WIDTH, 0));
-    Tetromino currentTetromino = createTetromino();
+    // Every cell style is drawn once here, then each frame's cells go out in a single textured call
+    CellAtlas atlas = {};
+    if (!createCellAtlas(renderer, atlas))
+    {
+        SDL_Log("Cell atlas could not be created! SDL_Error: %s", SDL_GetError());
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Text works the same way: glyphs baked once, strings kept as laid out quads, one call per frame
+    GlyphAtlas glyphs = {};
+    if (!createGlyphAtlas(renderer, glyphs))
+    {
+        SDL_Log("Glyph atlas could not be created! SDL_Error: %s", SDL_GetError());
+        destroyCellAtlas(atlas);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    Layer layers[LAYER_COUNT] = {};
+    bool hasLayers = true;
+    for (Layer& layer : layers)
+        hasLayers &= createLayer(renderer, layer, LAYER_WIDTH, SCREEN_HEIGHT);
+    if (!hasLayers)
+    {
+        SDL_Log("Layers could not be created! SDL_Error: %s", SDL_GetError());
+        for (Layer& layer : layers)
+            destroyLayer(layer);
+        destroyGlyphAtlas(glyphs);
+        destroyCellAtlas(atlas);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Each half of the window gets one board, scaled to fit whatever size the board is
+    Camera camera = fitCamera(BOARD_WIDTH, BOARD_HEIGHT, { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT });
+    Camera opponentCamera = fitCamera(BOARD_WIDTH, BOARD_HEIGHT, { SCREEN_WIDTH, 0, SCREEN_WIDTH, SCREEN_HEIGHT });
+    Camera queueCamera = fitCamera(QUEUE_SLOT_COLUMNS, QUEUE_SLOT_ROWS * NEXT_QUEUE_SIZE,
+        { QUEUE_FRAME.x + 5, QUEUE_FRAME.y + 5, QUEUE_FRAME.w - 10, QUEUE_FRAME.h - 10 });
+    uint64_t frameCount = 0;
+    Uint32 layerTitleTick = 0;
+    RectBatch batch = {};
+    SpriteBatch sprites = {};
+
+    // HUD text. Labels are laid out once; values only when they change.
+    TextBatch text = {};
+    TextRun nextLabel = createTextRun((float)QUEUE_FRAME.x, QUEUE_FRAME.y - 12.0f, 1, LABEL_COLOR, "NEXT");
+    TextRun statLabels = createTextRun((float)QUEUE_FRAME.x, (float)STATS_Y, 1, LABEL_COLOR, "SCORE\n\n\nLINES\n\n\nPIECES");
+    TextRun statValues = createTextRun((float)QUEUE_FRAME.x, (float)(STATS_Y + TEXT_LINE_HEIGHT), 1, VALUE_COLOR);
+    TextRun panelFps = createTextRun((float)QUEUE_FRAME.x, SCREEN_HEIGHT - 14.0f, 1, LABEL_COLOR);
+    TextRun overlayFps = createTextRun(4, SCREEN_HEIGHT - 12.0f, 1, LABEL_COLOR); // Versus and sandbox
+    TextRun versusScores[ROLLBACK_PLAYERS] = { createTextRun(4, 4, 1, VALUE_COLOR), createTextRun(SCREEN_WIDTH + 4.0f, 4, 1, VALUE_COLOR) };
+    uint32_t fpsFrames = 0;
+    Uint32 fpsTick = SDL_GetTicks();
+
+    Game game;
+    resetGame(game, static_cast<uint64_t>(time(0)));
+
+    // Precomputed clears from the openings tool answer common setups without searching; the book is optional
+    OpeningBook book;
+    openOpeningBook(book, "openings.tpc");
+
+    // Perfect clear hint, toggled with H and solved again for every new piece. The solve runs on its own
+    // thread; the last hint stays up until the one for the new piece is ready.
+    HintWorker* hintWorker = new HintWorker;
+    startHintWorker(*hintWorker, &book, (int)std::thread::hardware_concurrency());
+    PerfectClearSolution hint = {};
+    bool isHintShown = false;
+    int hintPieces = -1;
+
+    // Computer player, toggled with A; 1-3 pick the difficulty. It thinks on its own thread so
+    // frames never wait for it, and every new piece cancels whatever it was still working on.
+    AiWorker* worker = new AiWorker;
+    startAiWorker(*worker);
+    bool isAiPlaying = false;
+    int difficulty = DIFFICULTY_NORMAL;
+    int aiPieces = -1;
+    Uint32 aiStartTick = 0;
+    AiResult aiResult;
+    bool hasAiResult = false;
+
+    // Versus: this window is player 0 of local; remote stands in for the opponent's machine
+    RollbackSession* local = new RollbackSession;
+    RollbackSession* remote = new RollbackSession;
+    std::deque<SentInput> toLocal, toRemote;
+    HeuristicEvaluator opponentEvaluator;
+    Tetromino opponentTarget = {};
+    int opponentPieces = -1;
+    bool isVersus = false;
+    bool isDesyncReported = false; // Once per match
+    uint8_t versusMoves = 0; // Pressed since the last tick
+    Uint32 versusStartTick = 0;
+    uint64_t versusFrames = 0;
+    Uint32 versusTitleTick = 0;
+    ReplayWriter versusReplay = {};
+
+    // Sandbox: its own game on a field far larger than the window
+    SandboxGame* sandbox = new SandboxGame;
+    bool isSandbox = false;
+    Camera sandboxCamera = fitCamera(SANDBOX_VIEW_COLUMNS, SANDBOX_VIEW_ROWS, { 0, 0, WINDOW_WIDTH, SCREEN_HEIGHT });
+    bool isCameraFollowing = true;
+    uint64_t sandboxRects = 0; // Submitted for the last sandbox frame
 
     bool isRunning = true;
     SDL_Event event;
@@ -240,85 +306,450 @@ int main(int argc, char* argv[])
             {
                 isRunning = false;
             }
+            else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
+            {
+                // Layer contents are gone; each is drawn again on its next use
+                for (Layer& layer : layers)
+                    layer.isValid = false;
+            }
+            else if (event.type == SDL_KEYDOWN && isVersus)
+            {
+                switch (event.key.keysym.sym)
+                {
+                case SDLK_LEFT:
+                    versusMoves |= 1 << MOVE_LEFT;
+                    break;
+                case SDLK_RIGHT:
+                    versusMoves |= 1 << MOVE_RIGHT;
+                    break;
+                case SDLK_DOWN:
+                    versusMoves |= 1 << MOVE_SOFT_DROP;
+                    break;
+                case SDLK_UP:
+                    versusMoves |= 1 << MOVE_ROTATE;
+                    break;
+                case SDLK_SPACE:
+                    versusMoves |= 1 << MOVE_HARD_DROP;
+                    break;
+                case SDLK_v:
+                    isVersus = false;
+                    if (versusReplay.file != nullptr)
+                        closeReplayWriter(versusReplay);
+                    SDL_SetWindowSize(window, WINDOW_WIDTH, SCREEN_HEIGHT);
+                    SDL_SetWindowTitle(window, "Simple Tetris Game");
+                    break;
+                }
+            }
+            else if (event.type == SDL_KEYDOWN && isSandbox)
+            {
+                Tetromino& current = sandbox->current;
+                switch (event.key.keysym.sym)
+                {
+                case SDLK_LEFT:
+                    moveSandboxTetromino(current, -1, 0, sandbox->board);
+                    break;
+                case SDLK_RIGHT:
+                    moveSandboxTetromino(current, 1, 0, sandbox->board);
+                    break;
+                case SDLK_DOWN:
+                    moveSandboxTetromino(current, 0, 1, sandbox->board);
+                    break;
+                case SDLK_UP:
+                    rotateSandboxTetromino(current, sandbox->board);
+                    break;
+                case SDLK_SPACE:
+                    dropSandboxTetromino(current, sandbox->board);
+                    break;
+                case SDLK_w:
+                case SDLK_a:
+                case SDLK_s:
+                case SDLK_d:
+                {
+                    // A quarter of the view per press, whatever the zoom
+                    float stepX = sandboxCamera.viewport.w / sandboxCamera.cellSize / 4;
+                    float stepY = sandboxCamera.viewport.h / sandboxCamera.cellSize / 4;
+                    SDL_Keycode key = event.key.keysym.sym;
+                    sandboxCamera.x += key == SDLK_a ? -stepX : (key == SDLK_d ? stepX : 0);
+                    sandboxCamera.y += key == SDLK_w ? -stepY : (key == SDLK_s ? stepY : 0);
+                    isCameraFollowing = false;
+                    break;
+                }
+                case SDLK_f:
+                    isCameraFollowing = true;
+                    break;
+                case SDLK_EQUALS:
+                case SDLK_KP_PLUS:
+                case SDLK_MINUS:
+                case SDLK_KP_MINUS:
+                {
+                    SDL_Keycode key = event.key.keysym.sym;
+                    float factor = key == SDLK_EQUALS || key == SDLK_KP_PLUS ? SANDBOX_ZOOM_STEP : 1 / SANDBOX_ZOOM_STEP;
+                    zoomCamera(sandboxCamera, factor, WINDOW_WIDTH / 2, SCREEN_HEIGHT / 2);
+                    break;
+                }
+                case SDLK_b:
+                    isSandbox = false;
+                    SDL_SetWindowTitle(window, "Simple Tetris Game");
+                    break;
+                }
+            }
+            else if (event.type == SDL_MOUSEWHEEL && isSandbox)
+            {
+                int mouseX, mouseY;
+                SDL_GetMouseState(&mouseX, &mouseY);
+                zoomCamera(sandboxCamera, event.wheel.y > 0 ? SANDBOX_ZOOM_STEP : 1 / SANDBOX_ZOOM_STEP, mouseX, mouseY);
+            }
             else if (event.type == SDL_KEYDOWN)
             {
-                Tetromino movedTetromino = currentTetromino;
                 switch (event.key.keysym.sym)
                 {
                 case SDLK_LEFT:
-                    for (auto& block : movedTetromino.blocks)
-                        block.x--;
-                    if (!checkCollision(movedTetromino, board))
-                        currentTetromino = movedTetromino;
+                    if (moveTetromino(game.current, -1, 0, game.board))
+                        game.isLastMoveRotation = false;
                     break;
                 case SDLK_RIGHT:
-                    for (auto& block : movedTetromino.blocks)
-                        block.x++;
-                    if (!checkCollision(movedTetromino, board))
-                        currentTetromino = movedTetromino;
+                    if (moveTetromino(game.current, 1, 0, game.board))
+                        game.isLastMoveRotation = false;
                     break;
                 case SDLK_DOWN:
-                    for (auto& block : movedTetromino.blocks)
-                        block.y++;
-                    if (!checkCollision(movedTetromino, board))
-                        currentTetromino = movedTetromino;
+                    if (moveTetromino(game.current, 0, 1, game.board))
+                        game.isLastMoveRotation = false;
                     break;
                 case SDLK_UP: // Rotate
-                    rotateTetromino(movedTetromino);
-                    if (!checkCollision(movedTetromino, board))
-                        currentTetromino = movedTetromino;
+                    if (rotateTetromino(game.current, game.board))
+                        game.isLastMoveRotation = true;
                     break;
                 case SDLK_SPACE: // Drop
-                    dropTetromino(currentTetromino, board);
+                    if (moveTetromino(game.current, 0, 1, game.board))
+                    {
+                        dropTetromino(game.current, game.board);
+                        game.isLastMoveRotation = false;
+                    }
+                    break;
+                case SDLK_h: // Perfect clear hint
+                    isHintShown = !isHintShown;
+                    hintPieces = -1;
+                    hint.count = 0;
+                    cancelHintRequests(*hintWorker);
+                    break;
+                case SDLK_a: // Computer player
+                    isAiPlaying = !isAiPlaying;
+                    aiPieces = -1;
+                    if (!isAiPlaying)
+                        cancelAiRequests(*worker);
+                    break;
+                case SDLK_1:
+                case SDLK_2:
+                case SDLK_3:
+                    difficulty = event.key.keysym.sym - SDLK_1;
+                    aiPieces = -1;
+                    break;
+                case SDLK_v: // Versus
+                {
+                    uint64_t seed = static_cast<uint64_t>(time(0));
+                    startRollback(*local, seed, 0);
+                    startRollback(*remote, seed, 1);
+                    if (!openReplayWriter(versusReplay, "versus.tpr", seed))
+                        versusReplay.file = nullptr;
+                    toLocal.clear();
+                    toRemote.clear();
+                    opponentPieces = -1;
+                    versusMoves = 0;
+                    versusStartTick = SDL_GetTicks();
+                    versusFrames = 0;
+                    isDesyncReported = false;
+                    isVersus = true;
+                    isAiPlaying = false;
+                    cancelAiRequests(*worker);
+                    SDL_SetWindowSize(window, SCREEN_WIDTH * 2, SCREEN_HEIGHT);
+                    break;
+                }
+                case SDLK_b: // Sandbox
+                    resetSandboxGame(*sandbox, SANDBOX_WIDTH, SANDBOX_HEIGHT, static_cast<uint64_t>(time(0)));
+                    isSandbox = true;
+                    isCameraFollowing = true;
+                    isAiPlaying = false;
+                    cancelAiRequests(*worker);
                     break;
                 }
             }
         }
 
-        // Update the game state
-        Uint32 currentTick = SDL_GetTicks();
-        if (currentTick - lastTick > 500)
+        // Frames over the last second, shared by every mode
+        ++fpsFrames;
+        Uint32 frameTick = SDL_GetTicks();
+        if (frameTick - fpsTick >= 1000)
         {
-            Tetromino movedTetromino = currentTetromino;
-            for (auto& block : movedTetromino.blocks)
-                block.y++;
+            char fps[16];
+            snprintf(fps, sizeof(fps), "FPS %u", (unsigned)(fpsFrames * 1000 / (frameTick - fpsTick)));
+            setText(panelFps, fps);
+            setText(overlayFps, fps);
+            fpsFrames = 0;
+            fpsTick = frameTick;
+        }
 
-            if (checkCollision(movedTetromino, board))
+        if (isVersus)
+        {
+            // Fixed ticks; a session that is waiting on the other side skips its tick, like a stalled peer
+            Uint32 now = SDL_GetTicks();
+            while (versusFrames < (uint64_t)(now - versusStartTick) * VERSUS_TICK_RATE / 1000)
             {
-                placeTetromino(currentTetromino, board);
-                clearFullLines(board);
-                currentTetromino = createTetromino();
-                if (checkCollision(currentTetromino, board))
+                // Both sides take their inputs every tick, whatever the other one found
+                uint32_t localDesyncTicks = 0;
+                uint32_t remoteDesyncTicks = 0;
+                bool isLocalInSync = deliverInputs(toLocal, *local, 1, now, localDesyncTicks);
+                bool isRemoteInSync = deliverInputs(toRemote, *remote, 0, now, remoteDesyncTicks);
+
+                // The checksums roll, so once they part every later compare fails too; report the first only
+                if ((!isLocalInSync || !isRemoteInSync) && !isDesyncReported)
+                {
+                    writeDesyncReport(*local, *remote, isLocalInSync ? remoteDesyncTicks : localDesyncTicks);
+                    isDesyncReported = true;
+                }
+
+                if (advanceRollback(*local, versusMoves))
                 {
-                    // Game Over
-                    isRunning = false;
+                    toRemote.push_back(makeSentInput(*local, versusMoves, now));
+                    versusMoves = 0;
                 }
+
+                const Game& opponent = remote->match.players[1];
+                uint8_t opponentMoves = remote->match.tick % VERSUS_OPPONENT_TICKS == 0
+                    ? chooseOpponentMoves(opponent, opponentEvaluator, opponentTarget, opponentPieces) : 0;
+                if (advanceRollback(*remote, opponentMoves))
+                    toLocal.push_back(makeSentInput(*remote, opponentMoves, now));
+                if (versusReplay.file != nullptr)
+                    recordReplay(versusReplay, *local);
+                ++versusFrames;
             }
-            else
+
+            if (now - versusTitleTick >= 250)
             {
-                currentTetromino = movedTetromino;
+                const RollbackStats& stats = local->stats;
+                char title[192];
+                snprintf(title, sizeof(title), "Versus - rollbacks %llu, last %d ticks in %.1f us, max %d ticks in %.1f us, avg %.1f us, stalls %llu, desyncs %llu/%llu",
+                    (unsigned long long)stats.rollbacks, stats.lastDepth, stats.lastMicroseconds, stats.maxDepth, stats.maxMicroseconds,
+                    stats.rollbacks ? stats.totalMicroseconds / stats.rollbacks : 0.0, (unsigned long long)stats.stalls,
+                    (unsigned long long)stats.desyncs, (unsigned long long)stats.checksumsCompared);
+                SDL_SetWindowTitle(window, title);
+                versusTitleTick = now;
+            }
+
+            if (beginLayer(renderer, layers[LAYER_BACKGROUND], 1))
+            {
+                renderWell(renderer, BOARD_WIDTH, BOARD_HEIGHT, camera, batch);
+                renderWell(renderer, BOARD_WIDTH, BOARD_HEIGHT, opponentCamera, batch);
+                SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+                SDL_RenderDrawLine(renderer, SCREEN_WIDTH, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+                endLayer(renderer);
+            }
+            for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+            {
+                const Board& board = local->match.players[player].board;
+                if (beginLayer(renderer, layers[player == 0 ? LAYER_BOARD : LAYER_OPPONENT_BOARD], getBoardKey(board)))
+                {
+                    addBoardSprites(sprites, board, player == 0 ? camera : opponentCamera);
+                    flushSprites(renderer, sprites, atlas);
+                    endLayer(renderer);
+                }
+            }
+
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            drawLayer(renderer, layers[LAYER_BACKGROUND]);
+            drawLayer(renderer, layers[LAYER_BOARD]);
+            drawLayer(renderer, layers[LAYER_OPPONENT_BOARD]);
+            addPieceSprites(sprites, local->match.players[0], camera);
+            addPieceSprites(sprites, local->match.players[1], opponentCamera);
+            flushSprites(renderer, sprites, atlas);
+            renderGarbageMeter(renderer, local->match.garbage.queues[0].pending, camera);
+            renderGarbageMeter(renderer, local->match.garbage.queues[1].pending, opponentCamera);
+            for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+            {
+                char score[32];
+                snprintf(score, sizeof(score), "SCORE %d", local->match.players[player].score);
+                setText(versusScores[player], score);
+                addTextRun(text, versusScores[player]);
+            }
+            addTextRun(text, overlayFps);
+            flushText(renderer, text, glyphs);
+            SDL_RenderPresent(renderer);
+            lastTick = now;
+            continue;
+        }
+
+        if (isSandbox)
+        {
+            Uint32 now = SDL_GetTicks();
+            if (now - lastTick > 500)
+            {
+                applySandboxGravity(*sandbox);
+                isSandbox = !sandbox->isGameOver;
+                lastTick = now;
+
+                char title[128];
+                snprintf(title, sizeof(title), "Sandbox %dx%d - row %d, %lld lines, %zu chunks, %zu KB, %llu rects", SANDBOX_WIDTH, SANDBOX_HEIGHT,
+                    sandbox->current.y, (long long)sandbox->linesCleared, sandbox->board.occupied.size(), getSandboxMemory(sandbox->board) / 1024,
+                    (unsigned long long)sandboxRects);
+                SDL_SetWindowTitle(window, title);
+            }
+
+            const Tetromino& current = sandbox->current;
+            if (isCameraFollowing)
+                centerCamera(sandboxCamera, current.x + 0.5f, current.y + 0.5f);
+
+            Tetromino ghost = current;
+            dropSandboxTetromino(ghost, sandbox->board);
+
+            uint64_t submitted = batch.submitted;
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            renderSandbox(renderer, sandbox->board, sandboxCamera, batch);
+            addTetrominoSprites(sprites, ghost, sandboxCamera, true);
+            addTetrominoSprites(sprites, current, sandboxCamera);
+            flushSprites(renderer, sprites, atlas);
+            addTextRun(text, overlayFps);
+            flushText(renderer, text, glyphs);
+            SDL_RenderPresent(renderer);
+            sandboxRects = batch.submitted - submitted;
+            continue;
+        }
+
+        // Update the game state
+        Uint32 currentTick = SDL_GetTicks();
+        if (currentTick - lastTick > 500)
+        {
+            applyGravity(game);
+            if (game.isGameOver)
+            {
+                // Game Over
+                isRunning = false;
             }
             lastTick = currentTick;
         }
 
+        if (isAiPlaying && !game.isGameOver)
+        {
+            if (aiPieces != game.piecesPlaced && postAiRequest(*worker, game, DIFFICULTY_BUDGETS[difficulty], AI_THINK_LIMIT))
+            {
+                aiPieces = game.piecesPlaced;
+                aiStartTick = currentTick;
+                hasAiResult = false;
+            }
+            if (!hasAiResult)
+                hasAiResult = pollAiResult(*worker, aiResult);
+
+            if (hasAiResult && currentTick - aiStartTick >= AI_MOVE_DELAY)
+            {
+                char title[128];
+                snprintf(title, sizeof(title), "Simple Tetris Game - AI %s, depth %d, %llu nodes", DIFFICULTY_NAMES[difficulty], aiResult.depth,
+                    (unsigned long long)aiResult.nodes);
+                SDL_SetWindowTitle(window, title);
+
+                // The piece may have fallen into a spot the plan can no longer reach from; ask again
+                Tetromino landed;
+                if (findPlacement(game, aiResult.placement, landed))
+                {
+                    game.current = landed;
+                    game.isLastMoveRotation = false;
+                    lockTetromino(game);
+                    isRunning = !game.isGameOver;
+                }
+                aiPieces = -1;
+                hasAiResult = false;
+            }
+        }
+
+        if (isHintShown && hintPieces != game.piecesPlaced)
+        {
+            // Only the current piece and the queue are known
+            int pieces[HINT_PIECE_COUNT] = { game.current.type };
+            for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+                pieces[i + 1] = game.queue[i];
+            if (postHintRequest(*hintWorker, game.board, pieces))
+                hintPieces = game.piecesPlaced;
+        }
+        HintResult hintResult;
+        if (isHintShown && pollHintResult(*hintWorker, hintResult))
+            hint = hintResult.solution;
+
+        // Bring the cached layers up to date; usually none of them changed since the last frame
+        if (beginLayer(renderer, layers[LAYER_BACKGROUND], 0))
+        {
+            renderWell(renderer, BOARD_WIDTH, BOARD_HEIGHT, camera, batch);
+            renderPanelFrame(renderer, QUEUE_FRAME);
+            addTextRun(text, nextLabel);
+            addTextRun(text, statLabels);
+            flushText(renderer, text, glyphs);
+            endLayer(renderer);
+        }
+        if (beginLayer(renderer, layers[LAYER_BOARD], getBoardKey(game.board)))
+        {
+            addBoardSprites(sprites, game.board, camera);
+            flushSprites(renderer, sprites, atlas);
+            endLayer(renderer);
+        }
+        uint64_t hudKey = mixKey(mixKey(mixKey(getQueueKey(game.queue, NEXT_QUEUE_SIZE), game.score), game.linesCleared), game.piecesPlaced);
+        if (beginLayer(renderer, layers[LAYER_HUD], hudKey))
+        {
+            addQueueSprites(sprites, game.queue, NEXT_QUEUE_SIZE, queueCamera);
+            flushSprites(renderer, sprites, atlas);
+            char values[64];
+            snprintf(values, sizeof(values), "%d\n\n\n%d\n\n\n%d", game.score, game.linesCleared, game.piecesPlaced);
+            setText(statValues, values);
+            addTextRun(text, statValues);
+            flushText(renderer, text, glyphs);
+            endLayer(renderer);
+        }
+
         // Clear the screen
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);  // Black background
         SDL_RenderClear(renderer);
+        drawLayer(renderer, layers[LAYER_BACKGROUND]);
+        drawLayer(renderer, layers[LAYER_BOARD]);
+        drawLayer(renderer, layers[LAYER_HUD]);
 
-        // Render the board
-        renderBoard(renderer, board);
+        // Render the ghost tetromino and the current tetromino in one textured call
+        addPieceSprites(sprites, game, camera);
+        flushSprites(renderer, sprites, atlas);
 
-        // Render the ghost tetromino
-        renderGhostTetromino(renderer, currentTetromino, board);
+        if (isHintShown)
+            renderPerfectClearHint(renderer, hint, camera);
 
-        // Render the current tetromino
-        renderTetromino(renderer, currentTetromino);
+        addTextRun(text, panelFps);
+        flushText(renderer, text, glyphs);
 
         // Update the screen
         SDL_RenderPresent(renderer);
+        ++frameCount;
+
+        if (!isAiPlaying && currentTick - layerTitleTick >= 1000)
+        {
+            char title[192];
+            int length = snprintf(title, sizeof(title), "Simple Tetris Game - %llu frames, redraws", (unsigned long long)frameCount);
+            for (int i = 0; i < LAYER_COUNT && length < (int)sizeof(title); ++i)
+                length += snprintf(title + length, sizeof(title) - length, " %s %llu", LAYER_NAMES[i], (unsigned long long)layers[i].redraws);
+            SDL_SetWindowTitle(window, title);
+            layerTitleTick = currentTick;
+        }
     }
 
+    stopAiWorker(*worker);
+    delete worker;
+    stopHintWorker(*hintWorker);
+    delete hintWorker;
+    if (versusReplay.file != nullptr)
+        closeReplayWriter(versusReplay);
+    delete local;
+    delete remote;
+    delete sandbox;
+    closeOpeningBook(book);
+
     // Clean up and quit SDL
+    for (Layer& layer : layers)
+        destroyLayer(layer);
+    destroyGlyphAtlas(glyphs);
+    destroyCellAtlas(atlas);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
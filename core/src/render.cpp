@@ -0,0 +1,426 @@
+#include "render.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+Camera fitCamera(int columns, int rows, const SDL_Rect& area)
+{
+    int cellSize = area.w / columns < area.h / rows ? area.w / columns : area.h / rows;
+    Camera camera;
+    camera.cellSize = (float)cellSize;
+    camera.viewport = area;
+    camera.x = -(area.w - columns * cellSize) / 2.0f / cellSize;
+    camera.y = -(area.h - rows * cellSize) / 2.0f / cellSize;
+    return camera;
+}
+
+void centerCamera(Camera& camera, float x, float y)
+{
+    camera.x = x - camera.viewport.w / camera.cellSize / 2.0f;
+    camera.y = y - camera.viewport.h / camera.cellSize / 2.0f;
+}
+
+void zoomCamera(Camera& camera, float factor, int screenX, int screenY)
+{
+    float x = camera.x + (screenX - camera.viewport.x) / camera.cellSize;
+    float y = camera.y + (screenY - camera.viewport.y) / camera.cellSize;
+    float cellSize = camera.cellSize * factor;
+    camera.cellSize = cellSize < MIN_CELL_SIZE ? MIN_CELL_SIZE : (cellSize > MAX_CELL_SIZE ? MAX_CELL_SIZE : cellSize);
+    camera.x = x - (screenX - camera.viewport.x) / camera.cellSize;
+    camera.y = y - (screenY - camera.viewport.y) / camera.cellSize;
+}
+
+bool getVisibleCells(const Camera& camera, int columns, int rows, VisibleCells& cells)
+{
+    int left = (int)std::floor(camera.x);
+    int top = (int)std::floor(camera.y);
+    int right = (int)std::ceil(camera.x + camera.viewport.w / camera.cellSize) - 1;
+    int bottom = (int)std::ceil(camera.y + camera.viewport.h / camera.cellSize) - 1;
+    cells.x0 = left > 0 ? left : 0;
+    cells.y0 = top > 0 ? top : 0;
+    cells.x1 = right < columns - 1 ? right : columns - 1;
+    cells.y1 = bottom < rows - 1 ? bottom : rows - 1;
+    return cells.x0 <= cells.x1 && cells.y0 <= cells.y1;
+}
+
+SDL_FRect getCellRect(const Camera& camera, int x, int y, int columns)
+{
+    return { camera.viewport.x + (x - camera.x) * camera.cellSize, camera.viewport.y + (y - camera.y) * camera.cellSize,
+        columns * camera.cellSize, camera.cellSize };
+}
+
+// Bits first..last set, both inclusive and below 64
+static uint64_t getColumnMask(int first, int last)
+{
+    uint64_t upTo = last == 63 ? ~0ull : (2ull << last) - 1;
+    return upTo & ~((1ull << first) - 1);
+}
+
+void addRowSpans(RectBatch& batch, const Camera& camera, uint64_t bits, int firstColumn, int y)
+{
+    while (bits)
+    {
+        int start = std::countr_zero(bits);
+        int length = std::countr_one(bits >> start);
+        batch.rects.push_back(getCellRect(camera, firstColumn + start, y, length));
+        bits = start + length == 64 ? 0 : bits & (~0ull << (start + length));
+    }
+}
+
+void flushRects(SDL_Renderer* renderer, RectBatch& batch, Color color)
+{
+    if (batch.rects.empty())
+        return;
+
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRectsF(renderer, batch.rects.data(), (int)batch.rects.size());
+    batch.submitted += batch.rects.size();
+    batch.rects.clear();
+}
+
+// Channel scaled by a percentage and clamped, or mixed towards white when percent is above 100
+static uint8_t shade(uint8_t channel, int percent)
+{
+    int value = percent <= 100 ? channel * percent / 100 : channel + (255 - channel) * (percent - 100) / 100;
+    return (uint8_t)(value > 255 ? 255 : value);
+}
+
+// Pixel (u, v) of a tile: a dark outline, then a bevel lit from the top left, then the flat face.
+// Ghost tiles keep only a bright rim over a faint fill.
+static Color getTilePixel(int tile, int u, int v)
+{
+    bool isGhost = tile >= ATLAS_GHOST_TILES;
+    const Color& base = PALETTE[isGhost ? tile - ATLAS_GHOST_TILES : tile];
+    int left = u, top = v, right = ATLAS_TILE_SIZE - 1 - u, bottom = ATLAS_TILE_SIZE - 1 - v;
+    int edge = left < top ? left : top;
+    edge = edge < right ? edge : right;
+    edge = edge < bottom ? edge : bottom;
+
+    const int BEVEL = ATLAS_TILE_SIZE / 8;
+    if (isGhost)
+    {
+        if (edge < BEVEL / 2)
+            return { base.r, base.g, base.b, 200 };
+        return { shade(base.r, 50), shade(base.g, 50), shade(base.b, 50), 80 };
+    }
+
+    if (edge == 0)
+        return { shade(base.r, 40), shade(base.g, 40), shade(base.b, 40), 255 };
+    if (edge < BEVEL)
+    {
+        int percent = edge == left || edge == top ? 150 : 60;
+        return { shade(base.r, percent), shade(base.g, percent), shade(base.b, percent), 255 };
+    }
+    return base;
+}
+
+bool createCellAtlas(SDL_Renderer* renderer, CellAtlas& atlas)
+{
+    const int width = ATLAS_TILE_COUNT * ATLAS_TILE_STRIDE;
+    const int height = ATLAS_TILE_STRIDE;
+    std::vector<Color> pixels((size_t)width * height);
+    for (int tile = 0; tile < ATLAS_TILE_COUNT; ++tile)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < ATLAS_TILE_STRIDE; ++x)
+            {
+                // The gutter repeats the tile's outermost pixels
+                int u = x - 1 < 0 ? 0 : (x - 1 >= ATLAS_TILE_SIZE ? ATLAS_TILE_SIZE - 1 : x - 1);
+                int v = y - 1 < 0 ? 0 : (y - 1 >= ATLAS_TILE_SIZE ? ATLAS_TILE_SIZE - 1 : y - 1);
+                pixels[(size_t)y * width + tile * ATLAS_TILE_STRIDE + x] = getTilePixel(tile, u, v);
+            }
+        }
+    }
+
+    atlas.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (atlas.texture == nullptr)
+        return false;
+
+    SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+    if (SDL_UpdateTexture(atlas.texture, nullptr, pixels.data(), width * (int)sizeof(Color)) != 0)
+    {
+        destroyCellAtlas(atlas);
+        return false;
+    }
+    return true;
+}
+
+void destroyCellAtlas(CellAtlas& atlas)
+{
+    if (atlas.texture != nullptr)
+        SDL_DestroyTexture(atlas.texture);
+    atlas.texture = nullptr;
+}
+
+void addSprite(SpriteBatch& batch, const SDL_FRect& rect, int tile)
+{
+    // Texture coordinates stop half a texel inside the tile so filtering stays within it and its gutter
+    const float texelWidth = 1.0f / (ATLAS_TILE_COUNT * ATLAS_TILE_STRIDE);
+    const float texelHeight = 1.0f / ATLAS_TILE_STRIDE;
+    float u0 = (tile * ATLAS_TILE_STRIDE + 1 + 0.5f) * texelWidth;
+    float u1 = (tile * ATLAS_TILE_STRIDE + 1 + ATLAS_TILE_SIZE - 0.5f) * texelWidth;
+    float v0 = (1 + 0.5f) * texelHeight;
+    float v1 = (1 + ATLAS_TILE_SIZE - 0.5f) * texelHeight;
+
+    const SDL_Color white = { 255, 255, 255, 255 };
+    int first = (int)batch.vertices.size();
+    batch.vertices.push_back({ { rect.x, rect.y }, white, { u0, v0 } });
+    batch.vertices.push_back({ { rect.x + rect.w, rect.y }, white, { u1, v0 } });
+    batch.vertices.push_back({ { rect.x + rect.w, rect.y + rect.h }, white, { u1, v1 } });
+    batch.vertices.push_back({ { rect.x, rect.y + rect.h }, white, { u0, v1 } });
+    const int QUAD[] = { 0, 1, 2, 0, 2, 3 };
+    for (int corner : QUAD)
+        batch.indices.push_back(first + corner);
+}
+
+void flushSprites(SDL_Renderer* renderer, SpriteBatch& batch, const CellAtlas& atlas)
+{
+    if (batch.indices.empty())
+        return;
+
+    SDL_RenderGeometry(renderer, atlas.texture, batch.vertices.data(), (int)batch.vertices.size(), batch.indices.data(), (int)batch.indices.size());
+    batch.submitted += batch.vertices.size() / 4;
+    batch.vertices.clear();
+    batch.indices.clear();
+}
+
+template <int Width, int Height>
+void addBoardSprites(SpriteBatch& batch, const BasicBoard<Width, Height>& board, const Camera& camera)
+{
+    VisibleCells cells;
+    if (!getVisibleCells(camera, Width, Height, cells))
+        return;
+
+    uint64_t columns = getColumnMask(cells.x0, cells.x1);
+    for (int entry = 0; entry < PALETTE_SIZE; ++entry)
+    {
+        for (int y = cells.y0; y <= cells.y1; ++y)
+        {
+            for (uint64_t bits = getPaletteCells(board, y, entry) & columns; bits; bits &= bits - 1)
+                addSprite(batch, getCellRect(camera, std::countr_zero(bits), y), entry);
+        }
+    }
+}
+
+void addTetrominoSprites(SpriteBatch& batch, const Tetromino& tetromino, const Camera& camera, bool isGhost)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (const Block& block : blocks)
+        addSprite(batch, getCellRect(camera, block.x, block.y), isGhost ? ATLAS_GHOST_TILES + tetromino.type : tetromino.type);
+}
+
+template <int Width, int Height>
+void addPieceSprites(SpriteBatch& batch, const BasicGame<Width, Height>& game, const Camera& camera)
+{
+    // The ghost sits where the piece would land
+    Tetromino ghost = game.current;
+    dropTetromino(ghost, game.board);
+    addTetrominoSprites(batch, ghost, camera, true);
+    addTetrominoSprites(batch, game.current, camera);
+}
+
+void renderPerfectClearHint(SDL_Renderer* renderer, const PerfectClearSolution& solution, const Camera& camera)
+{
+    if (solution.count == 0)
+        return;
+
+    // Outline where the current piece goes in the perfect clear
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(solution.placements[0], blocks);
+
+    SDL_FRect rects[TETROMINO_SIZE];
+    for (int i = 0; i < TETROMINO_SIZE; ++i)
+        rects[i] = getCellRect(camera, blocks[i].x, blocks[i].y);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    SDL_RenderDrawRectsF(renderer, rects, TETROMINO_SIZE);
+}
+
+void addQueueSprites(SpriteBatch& batch, const int* queue, int count, const Camera& camera)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        Tetromino tetromino = { queue[i], 0, 0, 0 };
+        Block blocks[TETROMINO_SIZE];
+        getBlocks(tetromino, blocks);
+        int left = blocks[0].x, right = blocks[0].x, top = blocks[0].y, bottom = blocks[0].y;
+        for (const Block& block : blocks)
+        {
+            left = block.x < left ? block.x : left;
+            right = block.x > right ? block.x : right;
+            top = block.y < top ? block.y : top;
+            bottom = block.y > bottom ? block.y : bottom;
+        }
+
+        // Half-cell offsets center pieces of odd and even sizes alike
+        float offsetX = (QUEUE_SLOT_COLUMNS - (right - left + 1)) / 2.0f - left;
+        float offsetY = i * QUEUE_SLOT_ROWS + (QUEUE_SLOT_ROWS - (bottom - top + 1)) / 2.0f - top;
+        for (const Block& block : blocks)
+        {
+            SDL_FRect rect = getCellRect(camera, 0, 0);
+            rect.x += (block.x + offsetX) * camera.cellSize;
+            rect.y += (block.y + offsetY) * camera.cellSize;
+            addSprite(batch, rect, tetromino.type);
+        }
+    }
+}
+
+void renderWell(SDL_Renderer* renderer, int columns, int rows, const Camera& camera, RectBatch& batch)
+{
+    SDL_FRect field = getCellRect(camera, 0, 0, columns);
+    field.h = rows * camera.cellSize;
+    SDL_SetRenderDrawColor(renderer, 16, 16, 24, 255);
+    SDL_RenderFillRectF(renderer, &field);
+
+    // Grid lines one pixel wide, all in one submission
+    for (int x = 1; x < columns; ++x)
+        batch.rects.push_back({ field.x + x * camera.cellSize, field.y, 1, field.h });
+    for (int y = 1; y < rows; ++y)
+        batch.rects.push_back({ field.x, field.y + y * camera.cellSize, field.w, 1 });
+    flushRects(renderer, batch, { 40, 40, 56, 255 });
+
+    SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+    SDL_RenderDrawRectF(renderer, &field);
+}
+
+void renderPanelFrame(SDL_Renderer* renderer, const SDL_Rect& rect)
+{
+    SDL_SetRenderDrawColor(renderer, 16, 16, 24, 255);
+    SDL_RenderFillRect(renderer, &rect);
+    SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+    SDL_RenderDrawRect(renderer, &rect);
+}
+
+bool createLayer(SDL_Renderer* renderer, Layer& layer, int width, int height)
+{
+    layer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    layer.key = 0;
+    layer.isValid = false;
+    layer.redraws = 0;
+    if (layer.texture == nullptr)
+        return false;
+
+    SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void destroyLayer(Layer& layer)
+{
+    if (layer.texture != nullptr)
+        SDL_DestroyTexture(layer.texture);
+    layer.texture = nullptr;
+    layer.isValid = false;
+}
+
+bool beginLayer(SDL_Renderer* renderer, Layer& layer, uint64_t key)
+{
+    if (layer.isValid && layer.key == key)
+        return false;
+
+    SDL_SetRenderTarget(renderer, layer.texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    layer.key = key;
+    layer.isValid = true;
+    ++layer.redraws;
+    return true;
+}
+
+void endLayer(SDL_Renderer* renderer)
+{
+    SDL_SetRenderTarget(renderer, nullptr);
+}
+
+void drawLayer(SDL_Renderer* renderer, const Layer& layer)
+{
+    // Layers are sized for the widest window, so copy only the part the window shows, unscaled
+    int outputWidth = 0;
+    int outputHeight = 0;
+    int layerWidth = 0;
+    int layerHeight = 0;
+    SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+    SDL_QueryTexture(layer.texture, nullptr, nullptr, &layerWidth, &layerHeight);
+
+    SDL_Rect rect = { 0, 0, std::min(outputWidth, layerWidth), std::min(outputHeight, layerHeight) };
+    SDL_RenderCopy(renderer, layer.texture, &rect, &rect);
+}
+
+// FNV-1a
+static uint64_t hashBytes(uint64_t key, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i)
+        key = (key ^ bytes[i]) * 0x100000001B3ull;
+    return key;
+}
+
+template <int Width, int Height>
+uint64_t getBoardKey(const BasicBoard<Width, Height>& board)
+{
+    return hashBytes(hashBytes(0xCBF29CE484222325ull, board.rows, sizeof(board.rows)), board.palette, sizeof(board.palette));
+}
+
+uint64_t mixKey(uint64_t key, uint64_t value)
+{
+    return hashBytes(key, &value, sizeof(value));
+}
+
+uint64_t getQueueKey(const int* queue, int count)
+{
+    uint64_t key = (uint64_t)count;
+    for (int i = 0; i < count; ++i)
+        key = key << PALETTE_BITS | (uint64_t)queue[i];
+    return key;
+}
+
+void renderGarbageMeter(SDL_Renderer* renderer, int pending, const Camera& camera)
+{
+    SDL_FRect corner = getCellRect(camera, BOARD_WIDTH, BOARD_HEIGHT);
+    float height = (pending < BOARD_HEIGHT ? pending : BOARD_HEIGHT) * camera.cellSize;
+    SDL_FRect rect = { corner.x - 4, corner.y - height, 4, height };
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    SDL_RenderFillRectF(renderer, &rect);
+}
+
+void renderSandbox(SDL_Renderer* renderer, const SandboxBoard& board, const Camera& camera, RectBatch& batch)
+{
+    VisibleCells cells;
+    if (getVisibleCells(camera, board.width, board.height, cells))
+    {
+        for (int chunkY = cells.y0 >> SANDBOX_CHUNK_SHIFT; chunkY <= cells.y1 >> SANDBOX_CHUNK_SHIFT; ++chunkY)
+        {
+            int top = chunkY * SANDBOX_CHUNK_SIZE;
+            int firstRow = cells.y0 > top ? cells.y0 : top;
+            int lastRow = cells.y1 < top + SANDBOX_CHUNK_SIZE - 1 ? cells.y1 : top + SANDBOX_CHUNK_SIZE - 1;
+            for (int chunkX = cells.x0 >> SANDBOX_CHUNK_SHIFT; chunkX <= cells.x1 >> SANDBOX_CHUNK_SHIFT; ++chunkX)
+            {
+                uint32_t index = board.grid[(size_t)chunkY * board.chunkColumns + chunkX];
+                if (index == SANDBOX_EMPTY_CHUNK)
+                    continue;
+
+                const SandboxChunk& chunk = board.chunks[index];
+                int left = chunkX * SANDBOX_CHUNK_SIZE;
+                uint64_t columns = getColumnMask(cells.x0 > left ? cells.x0 - left : 0,
+                    cells.x1 < left + SANDBOX_CHUNK_SIZE - 1 ? cells.x1 - left : SANDBOX_CHUNK_SIZE - 1);
+                for (int y = firstRow; y <= lastRow; ++y)
+                    addRowSpans(batch, camera, chunk.rows[y - top] & columns, left, y);
+            }
+        }
+        flushRects(renderer, batch, { 255, 255, 255, 255 });
+    }
+
+    // Outline of the field, so its edges show when zoomed out
+    SDL_FRect field = getCellRect(camera, 0, 0, board.width);
+    field.h = board.height * camera.cellSize;
+    SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+    SDL_RenderDrawRectF(renderer, &field);
+}
+
+#define INSTANTIATE_RENDER(Width, Height) \
+    template void addBoardSprites(SpriteBatch&, const BasicBoard<Width, Height>&, const Camera&); \
+    template void addPieceSprites(SpriteBatch&, const BasicGame<Width, Height>&, const Camera&); \
+    template uint64_t getBoardKey(const BasicBoard<Width, Height>&);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_RENDER)
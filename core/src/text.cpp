@@ -0,0 +1,198 @@
+#include "text.h"
+
+#include <cstring>
+
+// The 8x8 cell of SDL_test_font.h, whose own glyph data lives in the SDL2test library this project does
+// not link. One byte per row, top to bottom, bit x is column x; 5x7 glyphs with a blank column on the
+// left and a blank row below.
+const uint8_t GLYPHS[GLYPH_COUNT][GLYPH_SIZE] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x08, 0x00 }, // '!'
+    { 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+    { 0x14, 0x3E, 0x14, 0x14, 0x3E, 0x14, 0x00, 0x00 }, // '#'
+    { 0x08, 0x3C, 0x0A, 0x1C, 0x28, 0x1E, 0x08, 0x00 }, // '$'
+    { 0x06, 0x26, 0x10, 0x08, 0x04, 0x32, 0x30, 0x00 }, // '%'
+    { 0x0C, 0x12, 0x0A, 0x04, 0x2A, 0x12, 0x2C, 0x00 }, // '&'
+    { 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+    { 0x10, 0x08, 0x04, 0x04, 0x04, 0x08, 0x10, 0x00 }, // '('
+    { 0x04, 0x08, 0x10, 0x10, 0x10, 0x08, 0x04, 0x00 }, // ')'
+    { 0x00, 0x08, 0x2A, 0x1C, 0x2A, 0x08, 0x00, 0x00 }, // '*'
+    { 0x00, 0x08, 0x08, 0x3E, 0x08, 0x08, 0x00, 0x00 }, // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x08, 0x04, 0x00 }, // ','
+    { 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x00, 0x00 }, // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+    { 0x00, 0x20, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00 }, // '/'
+    { 0x1C, 0x22, 0x32, 0x2A, 0x26, 0x22, 0x1C, 0x00 }, // '0'
+    { 0x08, 0x0C, 0x08, 0x08, 0x08, 0x08, 0x1C, 0x00 }, // '1'
+    { 0x1C, 0x22, 0x20, 0x10, 0x08, 0x04, 0x3E, 0x00 }, // '2'
+    { 0x3E, 0x10, 0x08, 0x10, 0x20, 0x22, 0x1C, 0x00 }, // '3'
+    { 0x10, 0x18, 0x14, 0x12, 0x3E, 0x10, 0x10, 0x00 }, // '4'
+    { 0x3E, 0x02, 0x1E, 0x20, 0x20, 0x22, 0x1C, 0x00 }, // '5'
+    { 0x18, 0x04, 0x02, 0x1E, 0x22, 0x22, 0x1C, 0x00 }, // '6'
+    { 0x3E, 0x20, 0x10, 0x08, 0x04, 0x04, 0x04, 0x00 }, // '7'
+    { 0x1C, 0x22, 0x22, 0x1C, 0x22, 0x22, 0x1C, 0x00 }, // '8'
+    { 0x1C, 0x22, 0x22, 0x3C, 0x20, 0x10, 0x0C, 0x00 }, // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x00 }, // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x08, 0x04, 0x00 }, // ';'
+    { 0x10, 0x08, 0x04, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '<'
+    { 0x00, 0x00, 0x3E, 0x00, 0x3E, 0x00, 0x00, 0x00 }, // '='
+    { 0x04, 0x08, 0x10, 0x20, 0x10, 0x08, 0x04, 0x00 }, // '>'
+    { 0x1C, 0x22, 0x20, 0x10, 0x08, 0x00, 0x08, 0x00 }, // '?'
+    { 0x1C, 0x22, 0x20, 0x2C, 0x2A, 0x2A, 0x1C, 0x00 }, // '@'
+    { 0x1C, 0x22, 0x22, 0x3E, 0x22, 0x22, 0x22, 0x00 }, // 'A'
+    { 0x1E, 0x22, 0x22, 0x1E, 0x22, 0x22, 0x1E, 0x00 }, // 'B'
+    { 0x1C, 0x22, 0x02, 0x02, 0x02, 0x22, 0x1C, 0x00 }, // 'C'
+    { 0x0E, 0x12, 0x22, 0x22, 0x22, 0x12, 0x0E, 0x00 }, // 'D'
+    { 0x3E, 0x02, 0x02, 0x1E, 0x02, 0x02, 0x3E, 0x00 }, // 'E'
+    { 0x3E, 0x02, 0x02, 0x1E, 0x02, 0x02, 0x02, 0x00 }, // 'F'
+    { 0x1C, 0x22, 0x02, 0x3A, 0x22, 0x22, 0x3C, 0x00 }, // 'G'
+    { 0x22, 0x22, 0x22, 0x3E, 0x22, 0x22, 0x22, 0x00 }, // 'H'
+    { 0x1C, 0x08, 0x08, 0x08, 0x08, 0x08, 0x1C, 0x00 }, // 'I'
+    { 0x38, 0x10, 0x10, 0x10, 0x10, 0x12, 0x0C, 0x00 }, // 'J'
+    { 0x22, 0x12, 0x0A, 0x06, 0x0A, 0x12, 0x22, 0x00 }, // 'K'
+    { 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x3E, 0x00 }, // 'L'
+    { 0x22, 0x36, 0x2A, 0x2A, 0x22, 0x22, 0x22, 0x00 }, // 'M'
+    { 0x22, 0x22, 0x26, 0x2A, 0x32, 0x22, 0x22, 0x00 }, // 'N'
+    { 0x1C, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1C, 0x00 }, // 'O'
+    { 0x1E, 0x22, 0x22, 0x1E, 0x02, 0x02, 0x02, 0x00 }, // 'P'
+    { 0x1C, 0x22, 0x22, 0x22, 0x2A, 0x12, 0x2C, 0x00 }, // 'Q'
+    { 0x1E, 0x22, 0x22, 0x1E, 0x0A, 0x12, 0x22, 0x00 }, // 'R'
+    { 0x3C, 0x02, 0x02, 0x1C, 0x20, 0x20, 0x1E, 0x00 }, // 'S'
+    { 0x3E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 }, // 'T'
+    { 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1C, 0x00 }, // 'U'
+    { 0x22, 0x22, 0x22, 0x22, 0x22, 0x14, 0x08, 0x00 }, // 'V'
+    { 0x22, 0x22, 0x22, 0x2A, 0x2A, 0x2A, 0x14, 0x00 }, // 'W'
+    { 0x22, 0x22, 0x14, 0x08, 0x14, 0x22, 0x22, 0x00 }, // 'X'
+    { 0x22, 0x22, 0x22, 0x14, 0x08, 0x08, 0x08, 0x00 }, // 'Y'
+    { 0x3E, 0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x00 }, // 'Z'
+    { 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x1C, 0x00 }, // '['
+    { 0x00, 0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x00 }, // '\\'
+    { 0x1C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00 }, // ']'
+    { 0x08, 0x14, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x00 }, // '_'
+};
+
+static int getGlyph(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        c = (char)(c - 'a' + 'A');
+    if (c < GLYPH_FIRST || c >= GLYPH_FIRST + GLYPH_COUNT)
+        c = '?';
+    return c - GLYPH_FIRST;
+}
+
+bool createGlyphAtlas(SDL_Renderer* renderer, GlyphAtlas& atlas)
+{
+    const int width = GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+    const int height = GLYPH_COUNT / GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+    std::vector<Color> pixels((size_t)width * height, Color{ 255, 255, 255, 0 });
+    for (int glyph = 0; glyph < GLYPH_COUNT; ++glyph)
+    {
+        int left = glyph % GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+        int top = glyph / GLYPH_ATLAS_COLUMNS * GLYPH_SIZE;
+        for (int y = 0; y < GLYPH_SIZE; ++y)
+        {
+            for (int x = 0; x < GLYPH_SIZE; ++x)
+            {
+                if ((GLYPHS[glyph][y] >> x) & 1)
+                    pixels[(size_t)(top + y) * width + left + x].a = 255;
+            }
+        }
+    }
+
+    atlas.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, width, height);
+    if (atlas.texture == nullptr)
+        return false;
+
+    // White glyphs tinted by the vertex color; nearest sampling keeps scaled pixels square
+    SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(atlas.texture, SDL_ScaleModeNearest);
+    if (SDL_UpdateTexture(atlas.texture, nullptr, pixels.data(), width * (int)sizeof(Color)) != 0)
+    {
+        destroyGlyphAtlas(atlas);
+        return false;
+    }
+    return true;
+}
+
+void destroyGlyphAtlas(GlyphAtlas& atlas)
+{
+    if (atlas.texture != nullptr)
+        SDL_DestroyTexture(atlas.texture);
+    atlas.texture = nullptr;
+}
+
+static void layOutText(TextRun& run)
+{
+    const float texelWidth = 1.0f / (GLYPH_ATLAS_COLUMNS * GLYPH_SIZE);
+    const float texelHeight = 1.0f / (GLYPH_COUNT / GLYPH_ATLAS_COLUMNS * GLYPH_SIZE);
+    const SDL_Color color = { run.color.r, run.color.g, run.color.b, run.color.a };
+    const float size = (float)(GLYPH_SIZE * run.scale);
+
+    run.vertices.clear();
+    float x = run.x, y = run.y;
+    for (const char* c = run.text; *c != '\0'; ++c)
+    {
+        if (*c == '\n')
+        {
+            x = run.x;
+            y += TEXT_LINE_HEIGHT * run.scale;
+            continue;
+        }
+
+        int glyph = getGlyph(*c);
+        if (glyph != 0) // Spaces only advance
+        {
+            float u0 = glyph % GLYPH_ATLAS_COLUMNS * GLYPH_SIZE * texelWidth;
+            float v0 = glyph / GLYPH_ATLAS_COLUMNS * GLYPH_SIZE * texelHeight;
+            float u1 = u0 + GLYPH_SIZE * texelWidth;
+            float v1 = v0 + GLYPH_SIZE * texelHeight;
+            SDL_Vertex topLeft = { { x, y }, color, { u0, v0 } };
+            SDL_Vertex topRight = { { x + size, y }, color, { u1, v0 } };
+            SDL_Vertex bottomRight = { { x + size, y + size }, color, { u1, v1 } };
+            SDL_Vertex bottomLeft = { { x, y + size }, color, { u0, v1 } };
+            run.vertices.insert(run.vertices.end(), { topLeft, topRight, bottomRight, topLeft, bottomRight, bottomLeft });
+        }
+        x += size;
+    }
+    ++run.layouts;
+}
+
+TextRun createTextRun(float x, float y, int scale, Color color, const char* text)
+{
+    TextRun run;
+    run.text[0] = '\0';
+    run.x = x;
+    run.y = y;
+    run.scale = scale;
+    run.color = color;
+    run.layouts = 0;
+    setText(run, text);
+    return run;
+}
+
+bool setText(TextRun& run, const char* text)
+{
+    if (run.layouts != 0 && strncmp(run.text, text, TEXT_RUN_CAPACITY - 1) == 0)
+        return false;
+
+    strncpy(run.text, text, TEXT_RUN_CAPACITY - 1);
+    run.text[TEXT_RUN_CAPACITY - 1] = '\0';
+    layOutText(run);
+    return true;
+}
+
+void addTextRun(TextBatch& batch, const TextRun& run)
+{
+    batch.vertices.insert(batch.vertices.end(), run.vertices.begin(), run.vertices.end());
+}
+
+void flushText(SDL_Renderer* renderer, TextBatch& batch, const GlyphAtlas& atlas)
+{
+    if (batch.vertices.empty())
+        return;
+
+    SDL_RenderGeometry(renderer, atlas.texture, batch.vertices.data(), (int)batch.vertices.size(), nullptr, 0);
+    batch.submitted += batch.vertices.size() / 6;
+    batch.vertices.clear();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "planner.h"
+#include "spsc_queue.h"
+
+#include <thread>
+
+// Runs the planner on its own thread. The game thread posts positions and polls for answers through
+// two single-producer/single-consumer queues; posting a new position cancels the search in progress.
+
+const int AI_QUEUE_CAPACITY = 4;
+const int AI_SLICE_MICROSECONDS = 500; // How often a search checks whether it has gone stale
+
+struct AiRequest
+{
+    Game game;
+    uint32_t generation;
+    PlannerBudget budget;  // Node budget per decision; the time budget is ignored
+    int timeLimitMilliseconds; // Answer with the best move so far after this long
+};
+
+struct AiResult
+{
+    Placement placement;
+    uint32_t generation; // Of the request it answers
+    int depth;
+    uint64_t nodes;
+    int slices; // runPlanner calls it took
+};
+
+struct AiWorker
+{
+    SpscQueue<AiRequest, AI_QUEUE_CAPACITY> requests;
+    SpscQueue<AiResult, AI_QUEUE_CAPACITY> results;
+    std::atomic<uint32_t> generation; // Bumped on every post and cancel; searches for older ones stop
+    std::atomic<bool> isStopping;
+    uint32_t nextGeneration; // Game thread only
+    std::thread thread;
+    HeuristicEvaluator evaluator;
+    Planner planner;
+};
+
+void startAiWorker(AiWorker& worker);
+void stopAiWorker(AiWorker& worker);
+
+// Game thread side. Returns false if the request queue is full.
+bool postAiRequest(AiWorker& worker, const Game& game, const PlannerBudget& budget, int timeLimitMilliseconds);
+void cancelAiRequests(AiWorker& worker);
+
+// Returns the answer to the latest request once it is ready; answers to older requests are dropped
+bool pollAiResult(AiWorker& worker, AiResult& result);
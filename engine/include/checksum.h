@@ -0,0 +1,20 @@
+#pragma once
+
+#include "game.h"
+#include "versus.h"
+
+#include <cstdio>
+
+// Rolling checksum of everything that decides how a game goes on: the rows, the active piece and the
+// rng. Folding each tick into the previous value means one compare covers the whole history, so peers,
+// replays and the server only need to exchange the latest one to catch a desync on the tick it happens.
+
+// A few multiplies per tick, cheap enough to leave on
+uint64_t rollChecksum(uint64_t checksum, const Game& game);
+
+// The garbage still waiting on each player and the rng that picks its holes, which decide the boards
+// just as much in a versus match
+uint64_t rollChecksum(uint64_t checksum, const VersusGarbage& garbage);
+
+// Human-readable dump of the same state, for comparing two games that disagree
+void dumpGame(FILE* file, const Game& game);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "game.h"
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <vector>
+
+// Chunked training dataset: header, independently decodable chunks, then a chunk index.
+// All integers are little-endian. Inside a chunk each record stores only the rows that
+// changed since the previous record, so the first record of every chunk is a keyframe.
+
+const char DATASET_MAGIC[4] = { 'T', 'D', 'S', '1' };
+const uint16_t DATASET_VERSION = 1;
+const int DATASET_CHUNK_RECORDS = 4096;
+
+struct DatasetHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint8_t boardWidth;
+    uint8_t boardHeight;
+    uint8_t queueSize;
+    uint8_t reserved[3];
+    uint32_t chunkCount;
+    uint64_t recordCount;
+    uint64_t indexOffset;
+};
+
+struct DatasetChunkEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t recordCount;
+};
+
+// One decision from self-play: the state seen, the action taken and what it led to
+struct DatasetRecord
+{
+    Board board;
+    uint8_t pieceType;
+    uint8_t queue[NEXT_QUEUE_SIZE];
+    uint8_t action; // rotation * BOARD_WIDTH + pivot column
+    uint8_t linesCleared;
+    bool isGameOver;
+};
+
+struct DatasetWriter
+{
+    FILE* file;
+    uint64_t offset; // Bytes written so far
+    DatasetHeader header;
+    std::vector<uint8_t> chunk;
+    uint32_t chunkRecords;
+    Board previousBoard;
+    std::vector<DatasetChunkEntry> index;
+};
+
+bool openDatasetWriter(DatasetWriter& writer, const char* path);
+// Both return false when the file could not be written
+bool writeDatasetRecord(DatasetWriter& writer, const DatasetRecord& record);
+bool closeDatasetWriter(DatasetWriter& writer);
+
+struct DatasetReader
+{
+    MappedFile file;
+    const DatasetHeader* header;
+    std::vector<DatasetChunkEntry> index; // Copied out of the file, which need not keep it aligned
+};
+
+bool openDatasetReader(DatasetReader& reader, const char* path);
+void closeDatasetReader(DatasetReader& reader);
+bool decodeDatasetChunk(const DatasetReader& reader, uint32_t chunk, std::vector<DatasetRecord>& records);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "game.h"
+#include "spin.h"
+
+const int MAX_CANDIDATES = ROTATION_COUNT * BOARD_WIDTH;
+
+// A distinct way to lock the current piece and the board it leaves behind
+struct Candidate
+{
+    Placement placement;
+    Tetromino tetromino; // Landed position
+    Board board;         // After line clears
+    int linesCleared;
+    SpinType spin; // What the slot scores when the piece is rotated into it last
+};
+
+// Scores every candidate of one piece in a single call so implementations can batch the work
+struct Evaluator
+{
+    virtual ~Evaluator() {}
+    virtual void evaluate(const Candidate* candidates, int count, float* scores) = 0;
+};
+
+// Hand-tuned linear combination of aggregate height, cleared lines, holes, bumpiness and spin clears
+struct HeuristicEvaluator : Evaluator
+{
+    void evaluate(const Candidate* candidates, int count, float* scores) override;
+};
+
+void getColumnHeights(const Board& board, int heights[BOARD_WIDTH]);
+int countHoles(const Board& board);
+
+int enumerateCandidates(const Game& game, Candidate candidates[MAX_CANDIDATES]);
+bool choosePlacement(const Game& game, Evaluator& evaluator, Placement& placement);
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+// The rules are templates on the board size and compiled for each size in FOR_EACH_BOARD_SIZE. Everything
+// above them (search, networking, replays) plays on the default size through the Board and Game aliases.
+const int BOARD_WIDTH = 10;
+const int BOARD_HEIGHT = 20;
+
+#define FOR_EACH_BOARD_SIZE(X) X(10, 20) X(10, 40) X(20, 15) X(26, 20)
+
+const int TETROMINO_SIZE = 4;
+const int ROTATION_COUNT = 4;
+const int NEXT_QUEUE_SIZE = 5;
+
+const int SPAWN_Y = 0;
+
+enum PieceType
+{
+    PIECE_LINE,
+    PIECE_SQUARE,
+    PIECE_T,
+    PIECE_L,
+    PIECE_REVERSE_L,
+    PIECE_TYPE_COUNT
+};
+
+struct Block
+{
+    int x, y;
+};
+
+// Offsets tried in order when a rotation is blocked, chosen once at startup for the whole process.
+// Every simulation that has to agree with another (rollback, replays, the server) must use the same one.
+enum RotationSystem
+{
+    ROTATION_NONE, // A blocked rotation fails, as the original game did
+    ROTATION_SRS,  // Guideline kicks
+    ROTATION_ARS,  // One column right, then left; the line never kicks
+    ROTATION_SYSTEM_COUNT
+};
+
+const int MAX_KICKS = 5; // Including the unkicked rotation
+
+struct Kick
+{
+    int8_t x, y;
+};
+
+struct Color
+{
+    uint8_t r, g, b, a;
+};
+
+// Every cell's color is an index into PALETTE: each piece type keeps its own, and garbage has one more
+const int PALETTE_GARBAGE = PIECE_TYPE_COUNT;
+const int PALETTE_SIZE = PIECE_TYPE_COUNT + 1;
+const int PALETTE_BITS = 3;
+
+static_assert(PALETTE_SIZE <= 1 << PALETTE_BITS, "Every palette index must fit in PALETTE_BITS");
+
+const Color PALETTE[PALETTE_SIZE] = {
+    { 0, 240, 240, 255 },   // Line
+    { 240, 240, 0, 255 },   // Square
+    { 160, 0, 240, 255 },   // T
+    { 240, 160, 0, 255 },   // L
+    { 0, 96, 255, 255 },    // Reverse L
+    { 128, 128, 128, 255 }, // Garbage
+};
+
+struct Tetromino
+{
+    int type; // Also its palette index
+    int rotation; // Quarter turns applied since spawn
+    int x, y;     // Position of the pivot block
+};
+
+// Occupied columns of one orientation, row by row from the topmost block, so a piece is tested
+// against the board with one AND per row instead of one lookup per block
+struct PieceMask
+{
+    uint8_t rows[TETROMINO_SIZE]; // Bit i is column left + i
+    int8_t top, left;             // Offsets of the first row and column from the pivot
+    int8_t height;
+};
+
+// Rows are widened by this many wall columns on each side, which covers every pivot offset
+const int PIECE_MASK_PAD = 4;
+
+// The narrowest unsigned type with a bit for every column, and for every column plus the walls
+template <int Bits>
+using UintFor = std::conditional_t<(Bits <= 16), uint16_t, std::conditional_t<(Bits <= 32), uint32_t, uint64_t>>;
+
+template <int Width, int Height>
+struct BasicBoard
+{
+    static_assert(Width >= TETROMINO_SIZE && Width + 2 * PIECE_MASK_PAD <= 64, "Padded rows must fit in 64 bits");
+
+    typedef UintFor<Width> Row; // Bit x is set when column x is occupied
+    typedef UintFor<Width + 2 * PIECE_MASK_PAD> PaddedRow;
+
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
+    static constexpr Row FULL_ROW = (Row)((1ull << Width) - 1);
+    static constexpr PaddedRow PADDED_WALLS = (PaddedRow)~((PaddedRow)FULL_ROW << PIECE_MASK_PAD);
+
+    Row rows[Height]; // rows[0] is the top line
+    // Palette index of every cell, one bit plane per index bit: bit x of palette[b][y] is bit b of the
+    // index at (x, y). Only meaningful where rows says the cell is occupied.
+    Row palette[PALETTE_BITS][Height];
+};
+
+typedef BasicBoard<BOARD_WIDTH, BOARD_HEIGHT> Board;
+typedef Board::Row Row;
+const Row FULL_ROW = Board::FULL_ROW;
+
+// Row y as a collision mask: the board shifted by PIECE_MASK_PAD with walls around it, open above
+// the board and solid below it
+template <int Width, int Height>
+inline typename BasicBoard<Width, Height>::PaddedRow getPaddedRow(const BasicBoard<Width, Height>& board, int y)
+{
+    typedef typename BasicBoard<Width, Height>::PaddedRow PaddedRow;
+    if (y >= Height)
+        return (PaddedRow)~(PaddedRow)0;
+    if (y < 0)
+        return BasicBoard<Width, Height>::PADDED_WALLS;
+    return (PaddedRow)(((PaddedRow)board.rows[y] << PIECE_MASK_PAD) | BasicBoard<Width, Height>::PADDED_WALLS);
+}
+
+// Cells of row y whose palette index is entry, as a row mask
+template <int Width, int Height>
+inline typename BasicBoard<Width, Height>::Row getPaletteCells(const BasicBoard<Width, Height>& board, int y, int entry)
+{
+    typedef typename BasicBoard<Width, Height>::Row BoardRow;
+    BoardRow cells = board.rows[y];
+    for (int b = 0; b < PALETTE_BITS; ++b)
+        cells &= (entry >> b) & 1 ? board.palette[b][y] : (BoardRow)~board.palette[b][y];
+    return cells;
+}
+
+struct Rng
+{
+    uint64_t state;
+};
+
+// Final resting place of a piece: the rotation to apply at spawn and the pivot column to shift to
+struct Placement
+{
+    int rotation;
+    int x;
+};
+
+template <int Width, int Height>
+struct BasicGame
+{
+    BasicBoard<Width, Height> board;
+    Tetromino current;
+    int queue[NEXT_QUEUE_SIZE]; // Upcoming piece types, queue[0] spawns next
+    Rng rng;
+    int linesCleared;
+    int piecesPlaced;
+    int score;
+    int lastSpin;            // SpinType of the last lock, see spin.h
+    bool isLastMoveRotation; // The current piece's last successful input was a rotation
+    bool isGameOver;
+};
+
+typedef BasicGame<BOARD_WIDTH, BOARD_HEIGHT> Game;
+
+void setRotationSystem(RotationSystem system);
+RotationSystem getRotationSystem();
+const char* getRotationSystemName(RotationSystem system);
+bool findRotationSystem(const char* name, RotationSystem& system);
+
+// Offsets to try, in order, when turning a piece of type clockwise from rotation; count receives how many
+const Kick* getKicks(int type, int rotation, int& count);
+
+void seedRng(Rng& rng, uint64_t seed);
+uint32_t nextRandom(Rng& rng);
+
+template <int Width, int Height>
+void clearBoard(BasicBoard<Width, Height>& board);
+template <int Width, int Height>
+bool isOccupied(const BasicBoard<Width, Height>& board, int x, int y);
+template <int Width, int Height>
+int getCellPalette(const BasicBoard<Width, Height>& board, int x, int y);
+
+Tetromino createTetromino(int type, int boardWidth = BOARD_WIDTH);
+void getBlocks(const Tetromino& tetromino, Block blocks[TETROMINO_SIZE]);
+
+const PieceMask& getPieceMask(int type, int rotation);
+template <int Width, int Height>
+bool collidesAt(const BasicBoard<Width, Height>& board, const PieceMask& mask, int x, int y);
+
+template <int Width, int Height>
+bool checkCollision(const Tetromino& tetromino, const BasicBoard<Width, Height>& board);
+template <int Width, int Height>
+bool moveTetromino(Tetromino& tetromino, int dx, int dy, const BasicBoard<Width, Height>& board);
+template <int Width, int Height>
+bool rotateTetromino(Tetromino& tetromino, const BasicBoard<Width, Height>& board); // Clockwise, trying each kick of the rotation system
+template <int Width, int Height>
+void dropTetromino(Tetromino& tetromino, const BasicBoard<Width, Height>& board);
+template <int Width, int Height>
+void placeTetromino(const Tetromino& tetromino, BasicBoard<Width, Height>& board);
+template <int Width, int Height>
+int clearFullLines(BasicBoard<Width, Height>& board);
+
+template <int Width, int Height>
+void resetGame(BasicGame<Width, Height>& game, uint64_t seed);
+template <int Width, int Height>
+int lockTetromino(BasicGame<Width, Height>& game);
+template <int Width, int Height>
+void applyGravity(BasicGame<Width, Height>& game);
+
+// Pushes the stack up and fills the bottom rows with holeColumn left open. Anything pushed out of the
+// top, or a piece that cannot be moved clear of the new rows, ends the game.
+template <int Width, int Height>
+void insertGarbageRows(BasicGame<Width, Height>& game, int count, int holeColumn);
+
+template <int Width, int Height>
+bool findPlacement(const BasicGame<Width, Height>& game, const Placement& placement, Tetromino& result);
+template <int Width, int Height>
+int applyPlacement(BasicGame<Width, Height>& game, const Placement& placement);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "opening_book.h"
+#include "perfect_clear.h"
+#include "spsc_queue.h"
+
+#include <thread>
+
+// Looks for perfect clears on its own thread, like AiWorker does for the planner, so a hard
+// position never holds up a frame. The opening book is asked first and the solver only on a miss.
+
+const int HINT_QUEUE_CAPACITY = 4;
+const int HINT_PIECE_COUNT = NEXT_QUEUE_SIZE + 1; // The current piece plus the queue
+const int HINT_MAX_HEIGHT = 4;
+
+struct HintRequest
+{
+    Board board;
+    int pieces[HINT_PIECE_COUNT];
+    uint32_t generation;
+};
+
+struct HintResult
+{
+    PerfectClearSolution solution; // count is 0 when there is no clear
+    uint32_t generation; // Of the request it answers
+};
+
+struct HintWorker
+{
+    SpscQueue<HintRequest, HINT_QUEUE_CAPACITY> requests;
+    SpscQueue<HintResult, HINT_QUEUE_CAPACITY> results;
+    std::atomic<uint32_t> generation; // Bumped on every post and cancel; queued requests for older ones are skipped
+    std::atomic<bool> isStopping;
+    uint32_t nextGeneration; // Game thread only
+    std::thread thread;
+    const OpeningBook* book; // Read only, owned by the game thread, which must stop the worker before closing it
+    int threadCount; // Given to every solve
+    PerfectClearSolver solver;
+};
+
+void startHintWorker(HintWorker& worker, const OpeningBook* book, int threadCount);
+void stopHintWorker(HintWorker& worker);
+
+// Game thread side. Returns false if the request queue is full.
+bool postHintRequest(HintWorker& worker, const Board& board, const int* pieces);
+void cancelHintRequests(HintWorker& worker);
+
+// Returns the answer to the latest request once it is ready; answers to older requests are dropped
+bool pollHintResult(HintWorker& worker, HintResult& result);
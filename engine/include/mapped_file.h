@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Read-only view of a whole file through the OS page cache
+struct MappedFile
+{
+    const uint8_t* data;
+    size_t size;
+    intptr_t fileHandle;
+    intptr_t mappingHandle;
+};
+
+bool mapFile(const char* path, MappedFile& file);
+void unmapFile(MappedFile& file);
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "game.h"
+
+// Binary protocol between game clients and the server. Every message starts with its type byte
+// and has a fixed size, so a TCP stream is parsed without length prefixes and a UDP datagram may
+// carry several messages back to back. Replication frames are the exception and carry a u16
+// payload size after the type. Integers are little-endian.
+
+const uint8_t NET_PROTOCOL_VERSION = 2;
+
+enum NetMessageType
+{
+    NET_HELLO = 1,   // Client: start a session
+    NET_INPUT = 2,   // Client: moves pressed since the last input
+    NET_WELCOME = 3, // Server: the session was created
+    NET_STATE = 4,   // Server: full state of the session
+    NET_SPECTATE = 5,    // Client: watch a session instead of playing
+    NET_REPLICATION = 6, // Server: keyframe or delta of a watched session, see replication.h
+};
+
+const int NET_HELLO_SIZE = 8;   // type, version, reserved[2], seed
+const int NET_INPUT_SIZE = 4;   // type, move bits, sequence
+const int NET_WELCOME_SIZE = 8; // type, version, reserved[2], session id
+const int NET_STATE_SIZE = 72;  // type, flags, acked input sequence, tick, rows, piece, queue, lines cleared, checksum
+const int NET_SPECTATE_SIZE = 8;  // type, version, reserved[2], session id
+const int NET_REPLICATION_HEADER_SIZE = 3; // type, payload size; the payload follows
+const int NET_MAX_MESSAGE_SIZE = NET_STATE_SIZE;
+
+const uint8_t NET_STATE_GAME_OVER = 0x01;
+
+inline int getNetMessageSize(uint8_t type)
+{
+    switch (type)
+    {
+    case NET_HELLO:
+        return NET_HELLO_SIZE;
+    case NET_INPUT:
+        return NET_INPUT_SIZE;
+    case NET_WELCOME:
+        return NET_WELCOME_SIZE;
+    case NET_STATE:
+        return NET_STATE_SIZE;
+    case NET_SPECTATE:
+        return NET_SPECTATE_SIZE;
+    default:
+        return 0;
+    }
+}
+
+inline void writeU16(uint8_t* bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+inline void writeU32(uint8_t* bytes, uint32_t value)
+{
+    writeU16(bytes, (uint16_t)value);
+    writeU16(bytes + 2, (uint16_t)(value >> 16));
+}
+
+inline uint16_t readU16(const uint8_t* bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+inline uint32_t readU32(const uint8_t* bytes)
+{
+    return readU16(bytes) | ((uint32_t)readU16(bytes + 2) << 16);
+}
+
+inline void writeU64(uint8_t* bytes, uint64_t value)
+{
+    writeU32(bytes, (uint32_t)value);
+    writeU32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+inline uint64_t readU64(const uint8_t* bytes)
+{
+    return readU32(bytes) | ((uint64_t)readU32(bytes + 4) << 32);
+}
+
+// Size of the message starting at bytes: 0 for an unknown type, -1 until enough has arrived to tell
+inline int getNetMessageSize(const uint8_t* bytes, int available)
+{
+    if (bytes[0] != NET_REPLICATION)
+        return getNetMessageSize(bytes[0]);
+    return available < NET_REPLICATION_HEADER_SIZE ? -1 : NET_REPLICATION_HEADER_SIZE + readU16(bytes + 1);
+}
+
+inline void writeHelloMessage(uint8_t* bytes, uint32_t seed)
+{
+    bytes[0] = NET_HELLO;
+    bytes[1] = NET_PROTOCOL_VERSION;
+    bytes[2] = bytes[3] = 0;
+    writeU32(bytes + 4, seed);
+}
+
+inline void writeInputMessage(uint8_t* bytes, uint8_t moves, uint16_t sequence)
+{
+    bytes[0] = NET_INPUT;
+    bytes[1] = moves;
+    writeU16(bytes + 2, sequence);
+}
+
+inline void writeSpectateMessage(uint8_t* bytes, uint32_t sessionId)
+{
+    bytes[0] = NET_SPECTATE;
+    bytes[1] = NET_PROTOCOL_VERSION;
+    bytes[2] = bytes[3] = 0;
+    writeU32(bytes + 4, sessionId);
+}
+
+inline void writeWelcomeMessage(uint8_t* bytes, uint32_t sessionId)
+{
+    bytes[0] = NET_WELCOME;
+    bytes[1] = NET_PROTOCOL_VERSION;
+    bytes[2] = bytes[3] = 0;
+    writeU32(bytes + 4, sessionId);
+}
+
+// The checksum is the session's rolling checksum as of tick, see checksum.h
+inline void writeStateMessage(uint8_t* bytes, const Game& game, uint32_t tick, uint16_t ackedSequence, uint64_t checksum)
+{
+    bytes[0] = NET_STATE;
+    bytes[1] = game.isGameOver ? NET_STATE_GAME_OVER : 0;
+    writeU16(bytes + 2, ackedSequence);
+    writeU32(bytes + 4, tick);
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+        writeU16(bytes + 8 + y * 2, game.board.rows[y]);
+    bytes[48] = (uint8_t)game.current.type;
+    bytes[49] = (uint8_t)game.current.rotation;
+    bytes[50] = (uint8_t)(int8_t)game.current.x;
+    bytes[51] = (uint8_t)(int8_t)game.current.y;
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        bytes[52 + i] = (uint8_t)game.queue[i];
+    writeU32(bytes + 57, (uint32_t)game.linesCleared);
+    bytes[61] = bytes[62] = bytes[63] = 0;
+    writeU64(bytes + 64, checksum);
+}
+
+// Fills in what a client can see; cell colors and the rng are not sent
+inline void readStateMessage(const uint8_t* bytes, Game& game, uint32_t& tick, uint16_t& ackedSequence, uint64_t& checksum)
+{
+    game.isGameOver = (bytes[1] & NET_STATE_GAME_OVER) != 0;
+    ackedSequence = readU16(bytes + 2);
+    tick = readU32(bytes + 4);
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+        game.board.rows[y] = readU16(bytes + 8 + y * 2);
+    game.current.type = bytes[48];
+    game.current.rotation = bytes[49];
+    game.current.x = (int8_t)bytes[50];
+    game.current.y = (int8_t)bytes[51];
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        game.queue[i] = bytes[52 + i];
+    game.linesCleared = (int)readU32(bytes + 57);
+    checksum = readU64(bytes + 64);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "evaluator.h"
+#include "mapped_file.h"
+
+// Small MLP scoring a candidate from its cells plus a handful of summary features:
+//   score = outputWeights . relu(inputWeights^T * input + hiddenBias) + outputBias
+// Weights are read in place from a flat little-endian file:
+//   NeuralWeightsHeader, inputWeights[NEURAL_INPUT_SIZE][hiddenSize], hiddenBias[hiddenSize],
+//   outputWeights[hiddenSize], outputBias
+
+const int NEURAL_CELL_INPUTS = BOARD_WIDTH * BOARD_HEIGHT; // Input y * BOARD_WIDTH + x is 1 when that cell is filled
+const int NEURAL_FEATURE_INPUTS = BOARD_WIDTH + 4;         // Column heights, holes, bumpiness, lines cleared, aggregate height
+const int NEURAL_INPUT_SIZE = NEURAL_CELL_INPUTS + NEURAL_FEATURE_INPUTS;
+
+const int NEURAL_LANES = 8; // hiddenSize must be a multiple of this
+const int NEURAL_MAX_HIDDEN = 512;
+
+const char NEURAL_MAGIC[4] = { 'T', 'N', 'N', '1' };
+const uint32_t NEURAL_VERSION = 1;
+
+struct NeuralWeightsHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t inputSize;
+    uint32_t hiddenSize;
+    uint32_t reserved[4];
+};
+
+// Work for one evaluate call: which input columns each candidate adds on top of its starting accumulator
+struct NeuralBatch
+{
+    int count;
+    int baseCount;
+    uint16_t baseCells[NEURAL_CELL_INPUTS];
+    bool isFromBase[MAX_CANDIDATES];
+    int cellCount[MAX_CANDIDATES];
+    uint16_t cells[MAX_CANDIDATES][NEURAL_CELL_INPUTS];
+    float features[MAX_CANDIDATES][NEURAL_FEATURE_INPUTS];
+};
+
+struct NeuralEvaluator : Evaluator
+{
+    MappedFile file;
+    int hiddenSize;
+    const float* inputWeights;
+    const float* hiddenBias;
+    const float* outputWeights;
+    float outputBias;
+    bool useAvx2;
+    NeuralBatch batch;
+
+    NeuralEvaluator();
+    ~NeuralEvaluator() override;
+
+    bool load(const char* path);
+    void evaluate(const Candidate* candidates, int count, float* scores) override;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "perfect_clear.h"
+
+#include <vector>
+
+// Precomputed perfect clears: an OpeningHeader followed by OpeningEntry records sorted by
+// (boardKey, queueKey). Lookups binary search the mapped file in place, so nothing is loaded up front.
+// Only the canonical side of each mirror pair is stored; lookups of the other side mirror the answer.
+
+const char OPENING_MAGIC[4] = { 'T', 'P', 'C', '1' };
+const uint32_t OPENING_VERSION = 3; // 3: rotation system
+const int OPENING_QUEUE_SIZE = NEXT_QUEUE_SIZE + 1; // The current piece plus the queue
+
+// Set when the mirrored placements are also reachable. Rotation only turns clockwise, so a
+// spin does not always have a mirror image; those entries answer for the canonical side only.
+// Which placements are reachable depends on the kicks, so a book only loads under the rotation
+// system it was built with.
+const uint8_t OPENING_MIRROR_VALID = 0x01;
+
+struct OpeningHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t entryCount;
+    uint32_t queueSize;
+    uint32_t maxHeight;
+    uint8_t rotationSystem; // The kicks the book was solved with
+    uint8_t reserved[7];
+};
+
+struct OpeningPlacement
+{
+    int8_t rotation;
+    int8_t x, y; // Pivot in board coordinates
+    uint8_t reserved;
+};
+
+struct OpeningEntry
+{
+    uint64_t boardKey;
+    uint32_t queueKey;
+    uint8_t count; // Pieces the clear uses, at most OPENING_QUEUE_SIZE
+    uint8_t flags;
+    uint8_t reserved[2];
+    OpeningPlacement placements[OPENING_QUEUE_SIZE];
+};
+
+struct OpeningBook
+{
+    MappedFile file;
+    const OpeningHeader* header;
+    const OpeningEntry* entries;
+};
+
+// Boards whose cells all sit in the bottom PC_MAX_HEIGHT rows pack exactly into a key; others have none
+bool getOpeningBoardKey(const Board& board, uint64_t& key);
+uint32_t getOpeningQueueKey(const int* pieces);
+
+// board and pieces must already be canonical, see canonicalizePosition
+void makeOpeningEntry(const Board& board, const int* pieces, const PerfectClearSolution& solution, bool isMirrorValid, OpeningEntry& entry);
+// Both use the current rotation system; a book built under another one does not open
+bool writeOpeningBook(const char* path, std::vector<OpeningEntry>& entries, int maxHeight);
+
+bool openOpeningBook(OpeningBook& book, const char* path);
+void closeOpeningBook(OpeningBook& book);
+bool findOpening(const OpeningBook& book, const Board& board, const int* pieces, PerfectClearSolution& solution);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "game.h"
+
+// Inputs the player has; hard drop moves the piece to the floor without locking it, like SDLK_SPACE
+enum Move
+{
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    MOVE_ROTATE,
+    MOVE_SOFT_DROP,
+    MOVE_HARD_DROP,
+    MOVE_COUNT
+};
+
+const int GRAVITY_TICKS = 30; // Fixed-rate simulations run 60 ticks a second, so the same 500 ms as the game window
+
+// Kicks can lift the pivot above the top row, so states cover a few rows over the board as well
+const int PATH_ROWS_ABOVE = TETROMINO_SIZE;
+const int PATH_STATE_ROWS = PATH_ROWS_ABOVE + BOARD_HEIGHT;
+const int PATH_STATE_COUNT = ROTATION_COUNT * PATH_STATE_ROWS * BOARD_WIDTH;
+const int MAX_PATH_LENGTH = PATH_STATE_COUNT;
+
+// Breadth-first search over every (rotation, y, x) pose reachable from a starting piece.
+// parents[state] packs the previous state and the move taken: (parent << 3) | (move + 1), 0 = unreached.
+struct Reachability
+{
+    Tetromino start;
+    uint16_t parents[PATH_STATE_COUNT];
+};
+
+void findReachable(const Board& board, const Tetromino& start, Reachability& reachability);
+bool isReachable(const Reachability& reachability, const Tetromino& target);
+int getLandedTetrominoes(const Reachability& reachability, const Board& board, Tetromino* landed);
+int findPath(const Reachability& reachability, const Tetromino& target, Move* path);
+bool applyMove(Tetromino& tetromino, Move move, const Board& board);
+
+// One fixed-rate tick: the moves pressed this tick as bits in Move order, then gravity every GRAVITY_TICKS.
+// Returns true if anything changed. Everything that simulates by ticks goes through here so it stays in lockstep.
+bool stepGame(Game& game, uint8_t moves, int& gravityTicks);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "game.h"
+
+#include <atomic>
+#include <memory>
+
+const int PC_MAX_HEIGHT = 6;  // Six rows of ten columns still pack into one 64-bit key
+const int PC_MAX_PIECES = 16;
+const int PC_FAILED_CAPACITY = 1 << 18; // Cleared on every solve, so kept small
+
+struct PerfectClearSolution
+{
+    int count;
+    Tetromino placements[PC_MAX_PIECES]; // Landed poses in board coordinates, one per piece in order
+};
+
+// Search state shared by all worker threads of one solve
+struct PerfectClearSolver
+{
+    std::unique_ptr<std::atomic<uint64_t>[]> failedStates; // Open addressing set of states known to have no solution
+    std::atomic<uint64_t> nodes;
+};
+
+// Looks for placements of pieces[0..pieceCount) in order that leave the board empty, trying
+// perfect clears of increasing height up to maxHeight. Returns false if none exists.
+bool solvePerfectClear(PerfectClearSolver& solver, const Board& board, const int* pieces, int pieceCount, int maxHeight, int threadCount, PerfectClearSolution& solution);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "game.h"
+
+// Number of distinct board sequences reachable by locking the next depth pieces.
+// Placements that lock into the same cells count once; a topped out game ends its branch.
+uint64_t perft(const Game& game, int depth);
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "evaluator.h"
+
+#include <chrono>
+
+// Iterative-deepening lookahead over the current piece and the preview that can stop after any
+// step and pick up where it left off, so it can run a slice at a time inside a frame.
+// Depth 1 scores the current piece's placements; every extra ply adds the next preview piece.
+
+const int PLANNER_MAX_DEPTH = NEXT_QUEUE_SIZE + 1; // Deeper plies would need pieces nobody has seen
+const float PLANNER_LOSS = -1.0e30f;
+
+// Limits for one runPlanner call and for one decision; 0 means unlimited
+struct PlannerBudget
+{
+    int microseconds; // Per call, checked before every step
+    uint64_t nodes;   // Per decision
+};
+
+enum Difficulty
+{
+    DIFFICULTY_EASY,
+    DIFFICULTY_NORMAL,
+    DIFFICULTY_HARD,
+    DIFFICULTY_COUNT
+};
+
+// Difficulty only changes how much the same search may do
+const PlannerBudget DIFFICULTY_BUDGETS[DIFFICULTY_COUNT] =
+{
+    { 1000, 1 }, // Greedy: stops once the first ply is scored
+    { 2000, 4000 },
+    { 4000, 0 },
+};
+
+// One position on the explicit search stack
+struct PlannerFrame
+{
+    Game game;
+    Candidate candidates[MAX_CANDIDATES];
+    int count;
+    int next; // Candidate whose subtree is searched next
+    float best;
+    bool isExpanded;
+};
+
+struct Planner
+{
+    Evaluator* evaluator;
+    Game root;
+    int maxDepth;
+    int depth; // Depth of the iteration in progress
+    PlannerFrame frames[PLANNER_MAX_DEPTH];
+    int frameCount;
+
+    Placement bestPlacement; // Best move of the deepest iteration that has an answer
+    float bestScore;
+    int bestDepth;
+    bool hasBest;
+
+    uint64_t nodes;      // Candidates generated since startPlanner
+    uint64_t frameNodes; // Candidates generated by the last runPlanner call
+    float stepMicroseconds; // Recent worst step time, so a call never starts a step it cannot finish
+    bool isDone;
+};
+
+void startPlanner(Planner& planner, const Game& game, Evaluator& evaluator, int maxDepth);
+
+// Searches until the budget runs out or the deepest iteration ends. Returns true once the planner
+// is done; bestPlacement is usable as soon as hasBest is set.
+bool runPlanner(Planner& planner, const PlannerBudget& budget);
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "rollback.h"
+
+#include <cstdio>
+
+// Recording of a versus match: the seed, then for every tick the moves of both players and the match
+// checksum after it. Played back through the same stepGame it must give the same checksums, and the
+// first tick that does not is where the simulation stopped being deterministic.
+
+const char REPLAY_MAGIC[4] = { 'T', 'R', 'P', '1' };
+const uint16_t REPLAY_VERSION = 5; // 2: garbage, 3: rotation system, 4: pieces no longer draw a color from the rng, 5: checksums cover queued garbage
+
+struct ReplayHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint8_t playerCount;
+    uint8_t rotationSystem; // The kicks the match was played with
+    uint8_t reserved[4];
+    uint32_t tickCount;
+    uint64_t seed;
+};
+
+struct ReplayTick
+{
+    uint8_t moves[ROLLBACK_PLAYERS];
+    uint8_t reserved[6];
+    uint64_t checksum;
+};
+
+struct ReplayWriter
+{
+    FILE* file;
+    ReplayHeader header;
+};
+
+bool openReplayWriter(ReplayWriter& writer, const char* path, uint64_t seed);
+
+// Appends every tick the session has made final since the last call; call at least once per window
+void recordReplay(ReplayWriter& writer, const RollbackSession& session);
+bool closeReplayWriter(ReplayWriter& writer);
+
+struct ReplayResult
+{
+    uint32_t tickCount;
+    uint32_t desyncTick; // First tick whose checksum differs, or NO_ROLLBACK
+    Match agreed;        // The last match both agree on
+    Match diverged;      // The replayed match after desyncTick
+    uint64_t recordedChecksum;
+};
+
+// Simulates the whole recording again under the rotation system it was recorded with, which stays selected
+// afterwards; false if the file is not a replay
+bool playReplay(const char* path, ReplayResult& result);
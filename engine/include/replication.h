@@ -0,0 +1,50 @@
+#pragma once
+
+#include "game.h"
+#include "net_protocol.h"
+#include "varint.h"
+
+// Compact stream of what a spectator sees of one game. Each frame is a keyframe holding the whole
+// visible state or a delta against the previous frame, carrying only the rows that changed plus the
+// piece, queue and score when they did. Frames are encoded once and the same bytes go to every viewer.
+//
+// Payload: flags, varint frame number, varint tick (delta from the last frame unless a keyframe),
+// varint changed row mask followed by a varint row xor per set bit, then the optional sections
+// in flag order: piece (type and rotation byte, x + 4, y + 4), queue (3 bits per piece), lines cleared.
+
+const int REPLICATION_KEYFRAME_INTERVAL = 60; // Frames between keyframes, bounding how long a joiner or a lossy link waits
+const int REPLICATION_MAX_PAYLOAD = 3 + MAX_VARINT_BYTES * (BOARD_HEIGHT + 6);
+const int REPLICATION_MAX_FRAME = NET_REPLICATION_HEADER_SIZE + REPLICATION_MAX_PAYLOAD;
+
+const uint8_t REPLICATION_KEYFRAME = 0x01;
+const uint8_t REPLICATION_PIECE = 0x02;
+const uint8_t REPLICATION_QUEUE = 0x04;
+const uint8_t REPLICATION_LINES = 0x08;
+const uint8_t REPLICATION_GAME_OVER = 0x10;
+
+struct ReplicationEncoder
+{
+    Game previous;
+    uint32_t previousTick;
+    uint32_t frame;
+    uint32_t framesSinceKeyframe;
+    bool isKeyframeRequested; // Set when a viewer joins so it does not wait for the interval
+};
+
+struct ReplicationDecoder
+{
+    Game game; // Visible state only; the rng and cell colors are not replicated
+    uint32_t tick;
+    uint32_t frame;
+    bool hasKeyframe; // Deltas are ignored until a keyframe arrives, including after a lost frame
+};
+
+void resetReplicationEncoder(ReplicationEncoder& encoder);
+
+// Writes a whole NET_REPLICATION message and returns its size
+int encodeReplicationFrame(ReplicationEncoder& encoder, const Game& game, uint32_t tick, uint8_t* bytes);
+
+void resetReplicationDecoder(ReplicationDecoder& decoder);
+
+// Applies one NET_REPLICATION message. Returns false if it was malformed or could not be applied yet.
+bool decodeReplicationFrame(ReplicationDecoder& decoder, const uint8_t* bytes, int size);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "game.h"
+#include "versus.h"
+
+#include <cstdio>
+#include <type_traits>
+
+// GGPO style rollback for a two player match over a laggy link. Each tick the session keeps a copy
+// of the match from before the tick and the inputs it used. Remote inputs that have not arrived yet
+// are predicted; when one arrives and differs, the session goes back to the copy from before that
+// tick and simulates forward again with what it now knows. Local inputs are never late.
+
+const int ROLLBACK_PLAYERS = VERSUS_PLAYERS;
+const int ROLLBACK_WINDOW = 16; // Ticks of history; a remote player this far behind stalls the session instead
+const uint32_t NO_ROLLBACK = ~0u;
+
+// Both players and the garbage between them, so a snapshot is one copy
+struct Match
+{
+    Game players[ROLLBACK_PLAYERS];
+    int gravityTicks[ROLLBACK_PLAYERS];
+    VersusGarbage garbage;
+    uint32_t tick; // Ticks simulated so far
+    uint64_t checksum; // Rolled over both players after every tick, see checksum.h
+};
+
+static_assert(std::is_trivially_copyable_v<Match>, "Rollback snapshots are plain copies");
+
+struct RollbackStats
+{
+    uint64_t ticks;
+    uint64_t stalls; // Ticks not simulated because a remote player was a whole window behind
+    uint64_t checksumsCompared;
+    uint64_t desyncs;
+    uint64_t rollbacks;
+    uint64_t resimulatedTicks;
+    int lastDepth; // Ticks simulated again by the last rollback
+    int maxDepth;
+    double lastMicroseconds; // Cost of the last rollback, restore included
+    double maxMicroseconds;
+    double totalMicroseconds;
+};
+
+struct RollbackSession
+{
+    Match match;
+    Match snapshots[ROLLBACK_WINDOW]; // snapshots[t % ROLLBACK_WINDOW] is the match before tick t
+    uint8_t inputs[ROLLBACK_WINDOW][ROLLBACK_PLAYERS]; // Moves tick t ran with, confirmed or predicted
+    uint32_t confirmedTicks[ROLLBACK_PLAYERS]; // Inputs of every tick before this one are known
+    uint32_t rollbackTick; // Earliest tick that ran on a wrong prediction, or NO_ROLLBACK
+    int localPlayer;
+    RollbackStats stats;
+};
+
+// Both players get the same seed, so the same pieces
+void resetMatch(Match& match, uint64_t seed);
+
+// One tick of both players, the moves in player order, with garbage settled after every lock
+void stepMatch(Match& match, const uint8_t moves[ROLLBACK_PLAYERS]);
+
+void startRollback(RollbackSession& session, uint64_t seed, int localPlayer);
+
+// Records a remote player's moves for a tick. Inputs come in tick order and no later than the
+// tick being simulated; returns false for one that cannot be taken yet, to be offered again later.
+bool addRemoteInput(RollbackSession& session, int player, uint32_t tick, uint8_t moves);
+
+// Repairs any misprediction, then simulates one tick with the local moves. Returns false and does
+// nothing while a remote player is a whole window behind.
+bool advanceRollback(RollbackSession& session, uint8_t localMoves);
+
+// Ticks whose inputs are all known and simulated with, so the match after them is final
+uint32_t getConfirmedTicks(const RollbackSession& session);
+
+// The match after the given number of ticks; only the last ROLLBACK_WINDOW are kept
+bool getMatchAt(const RollbackSession& session, uint32_t ticks, Match& match);
+
+// Compares a peer's checksum of the match after the given number of ticks with ours. Returns false on a
+// desync; a tick that is not final here yet or already out of the window is skipped and counts as agreeing.
+bool checkRemoteChecksum(RollbackSession& session, uint32_t ticks, uint64_t checksum);
+
+void dumpMatch(FILE* file, const Match& match);
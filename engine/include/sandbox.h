@@ -0,0 +1,68 @@
+#pragma once
+
+#include "game.h"
+
+#include <cstddef>
+#include <vector>
+
+// Fields far too large to store densely, for stress tests and streams. The field is cut into chunks of
+// SANDBOX_CHUNK_SIZE x SANDBOX_CHUNK_SIZE cells, one bit each, allocated the first time anything lands in
+// them. Every chunk position nothing has landed in shares the empty chunk at index 0, so collision, drops,
+// line clears and drawing only ever read real memory for chunks that hold cells.
+
+const int SANDBOX_CHUNK_SHIFT = 6;
+const int SANDBOX_CHUNK_SIZE = 1 << SANDBOX_CHUNK_SHIFT;
+const int SANDBOX_MAX_SIZE = 1 << 20; // Cells along either side
+const uint32_t SANDBOX_EMPTY_CHUNK = 0;
+
+struct SandboxChunk
+{
+    uint64_t rows[SANDBOX_CHUNK_SIZE]; // Bit x of rows[y] is column x of the chunk, as on Board
+    int cellCount;
+    int chunkX, chunkY;
+    int occupiedSlot; // Position in SandboxBoard::occupied
+};
+
+struct SandboxBoard
+{
+    int width, height; // In cells
+    int chunkColumns, chunkRows;
+    std::vector<uint32_t> grid;        // Chunk index for every chunk position, row by row
+    std::vector<SandboxChunk> chunks;  // chunks[SANDBOX_EMPTY_CHUNK] is all zero and never written
+    std::vector<uint32_t> freeChunks;  // Released chunks, reused before the pool grows
+    std::vector<uint32_t> occupied;    // Every chunk holding cells, in no particular order
+};
+
+struct SandboxGame
+{
+    SandboxBoard board;
+    Tetromino current;
+    Rng rng;
+    int64_t linesCleared;
+    int64_t piecesPlaced;
+    bool isGameOver;
+};
+
+// False if either side is outside 1..SANDBOX_MAX_SIZE
+bool createSandboxBoard(SandboxBoard& board, int width, int height);
+bool isSandboxOccupied(const SandboxBoard& board, int x, int y);
+size_t getSandboxMemory(const SandboxBoard& board);
+
+inline const SandboxChunk& getSandboxChunk(const SandboxBoard& board, int chunkX, int chunkY)
+{
+    return board.chunks[board.grid[(size_t)chunkY * board.chunkColumns + chunkX]];
+}
+
+// Same rules as the Board versions: walls at the sides and floor, open above the field
+bool checkSandboxCollision(const Tetromino& tetromino, const SandboxBoard& board);
+bool moveSandboxTetromino(Tetromino& tetromino, int dx, int dy, const SandboxBoard& board);
+bool rotateSandboxTetromino(Tetromino& tetromino, const SandboxBoard& board);
+void dropSandboxTetromino(Tetromino& tetromino, const SandboxBoard& board);
+void placeSandboxTetromino(const Tetromino& tetromino, SandboxBoard& board);
+
+// Clears the full rows among top..bottom; only rows a piece just filled can be full
+int clearSandboxLines(SandboxBoard& board, int top, int bottom);
+
+bool resetSandboxGame(SandboxGame& game, int width, int height, uint64_t seed);
+int lockSandboxTetromino(SandboxGame& game);
+void applySandboxGravity(SandboxGame& game);
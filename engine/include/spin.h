@@ -0,0 +1,16 @@
+#pragma once
+
+#include "game.h"
+
+// A lock that finished with a rotation into a tight spot. T pieces use the three-corner rule around
+// the pivot; every other piece counts as an all-spin when it cannot move left, right or up.
+enum SpinType
+{
+    SPIN_NONE,
+    SPIN_MINI, // Also every all-spin
+    SPIN_FULL,
+    SPIN_TYPE_COUNT
+};
+
+template <int Width, int Height>
+SpinType detectSpin(const BasicBoard<Width, Height>& board, const Tetromino& tetromino, bool isLastMoveRotation);
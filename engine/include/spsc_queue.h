@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size ring for exactly one producer thread and one consumer thread. Neither side ever
+// blocks or locks: push fails when full and pop fails when empty. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+struct SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    // Each index lives on its own cache line so the two threads do not fight over one
+    alignas(64) std::atomic<size_t> head; // Next slot to read, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // Next slot to write, written by the producer
+    alignas(64) T items[Capacity];
+
+    SpscQueue() : head(0), tail(0) {}
+
+    bool push(const T& item)
+    {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        items[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire))
+            return false;
+
+        item = items[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "game.h"
+
+// Left/right mirror images, so caches can store one entry per mirror pair. The line, square and T
+// are their own mirrors and the two L shapes swap; the game has no S or Z pieces.
+
+struct RowMirrorTable
+{
+    Row rows[1 << BOARD_WIDTH];
+};
+
+constexpr RowMirrorTable buildRowMirrorTable()
+{
+    RowMirrorTable table = {};
+    for (int row = 0; row < (1 << BOARD_WIDTH); ++row)
+    {
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            if (row & (1 << x))
+                table.rows[row] |= (Row)(1u << (BOARD_WIDTH - 1 - x));
+        }
+    }
+    return table;
+}
+
+inline constexpr RowMirrorTable ROW_MIRROR = buildRowMirrorTable();
+
+inline Row mirrorRow(Row row)
+{
+    return ROW_MIRROR.rows[row];
+}
+
+int mirrorPieceType(int type);
+void mirrorBoard(const Board& board, Board& mirrored);
+
+// The pose of the mirrored piece that covers the mirrored cells
+Tetromino mirrorTetromino(const Tetromino& tetromino);
+
+// Picks whichever of (board, pieces) and its mirror compares smaller, rows from the bottom up and
+// then the pieces. Returns true if the mirror was taken.
+bool canonicalizePosition(const Board& board, const int* pieces, int pieceCount, Board& canonical, int* canonicalPieces);
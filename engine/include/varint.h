@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// LEB128 style unsigned varints: 7 bits per byte, high bit set while more bytes follow
+const int MAX_VARINT_BYTES = 10;
+
+inline int writeVarint(uint8_t* out, uint64_t value)
+{
+    int size = 0;
+    while (value >= 0x80)
+    {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+// Returns the number of bytes consumed, or 0 if the input ends mid-varint
+inline int readVarint(const uint8_t* in, size_t available, uint64_t& value)
+{
+    value = 0;
+    for (int i = 0; i < MAX_VARINT_BYTES && (size_t)i < available; ++i)
+    {
+        value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0)
+            return i + 1;
+    }
+    return 0;
+}
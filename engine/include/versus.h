@@ -0,0 +1,44 @@
+#pragma once
+
+#include "game.h"
+#include "spin.h"
+
+// Two player rules: clearing lines attacks the opponent with garbage rows. An attack first cancels
+// garbage still waiting to land on the attacker, and whatever is left queues up for the opponent.
+// Queued garbage rises from the bottom the next time that player locks a piece without clearing.
+
+const int VERSUS_PLAYERS = 2;
+const int GARBAGE_QUEUE_CAPACITY = 8; // Attacks waiting on one player; a power of two for the ring
+const int MAX_GARBAGE_PER_LOCK = 8;   // Rows that may rise at once, the rest wait for the next lock
+
+// Garbage sent for each number of lines cleared, by the spin the lock scored
+const int ATTACK_LINES[SPIN_TYPE_COUNT][TETROMINO_SIZE + 1] =
+{
+    { 0, 0, 1, 2, 4 }, // Plain
+    { 0, 1, 2, 3, 4 }, // Mini and all-spins
+    { 0, 2, 4, 6, 8 }, // T-spins
+};
+
+// Attacks waiting to land on one player, oldest first. It is a ring, so cancelling from the front and
+// queueing at the back are constant time and the whole thing stays a plain copy for rollback.
+struct GarbageQueue
+{
+    uint8_t lines[GARBAGE_QUEUE_CAPACITY];
+    uint8_t holes[GARBAGE_QUEUE_CAPACITY]; // Column left open in every row of the attack
+    uint8_t head;
+    uint8_t count;
+    uint16_t pending; // Lines over all queued attacks
+};
+
+struct VersusGarbage
+{
+    GarbageQueue queues[VERSUS_PLAYERS];
+    Rng rng; // Hole columns; kept apart from the piece rngs so both players still get the same pieces
+    uint32_t linesSent[VERSUS_PLAYERS];
+};
+
+void resetVersusGarbage(VersusGarbage& garbage, uint64_t seed);
+
+// Settles what the piece the player just locked did: attack or cancel, then let garbage rise if it cleared nothing.
+// The spin comes from the player's lastSpin.
+void resolveLock(VersusGarbage& garbage, Game players[VERSUS_PLAYERS], int player, int linesCleared);
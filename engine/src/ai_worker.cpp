@@ -0,0 +1,101 @@
+#include "ai_worker.h"
+
+// Only an older generation is stale: a request is queued before its generation is published, so the
+// worker can see it while generation still holds the previous one
+static bool isStale(const AiWorker& worker, uint32_t generation)
+{
+    return worker.isStopping.load(std::memory_order_relaxed) || (int32_t)(worker.generation.load(std::memory_order_relaxed) - generation) > 0;
+}
+
+static void runAiWorker(AiWorker& worker)
+{
+    uint32_t seenGeneration = worker.generation.load();
+    while (!worker.isStopping.load())
+    {
+        AiRequest request;
+        if (!worker.requests.pop(request))
+        {
+            // Sleep until the game thread posts or cancels something
+            worker.generation.wait(seenGeneration);
+            seenGeneration = worker.generation.load();
+            continue;
+        }
+
+        // A newer request is already queued behind this one
+        if (isStale(worker, request.generation))
+            continue;
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(request.timeLimitMilliseconds);
+        PlannerBudget slice = { AI_SLICE_MICROSECONDS, request.budget.nodes };
+        startPlanner(worker.planner, request.game, worker.evaluator, PLANNER_MAX_DEPTH);
+
+        AiResult result = {};
+        result.generation = request.generation;
+        bool isCancelled = false;
+        while (!runPlanner(worker.planner, slice))
+        {
+            ++result.slices;
+            isCancelled = isStale(worker, request.generation);
+            if (isCancelled || (worker.planner.hasBest && std::chrono::steady_clock::now() >= deadline))
+                break;
+        }
+        if (isCancelled || !worker.planner.hasBest)
+            continue;
+
+        result.placement = worker.planner.bestPlacement;
+        result.depth = worker.planner.bestDepth;
+        result.nodes = worker.planner.nodes;
+        worker.results.push(result);
+    }
+}
+
+void startAiWorker(AiWorker& worker)
+{
+    worker.generation = 0;
+    worker.isStopping = false;
+    worker.nextGeneration = 0;
+    worker.thread = std::thread(runAiWorker, std::ref(worker));
+}
+
+void stopAiWorker(AiWorker& worker)
+{
+    worker.isStopping = true;
+    worker.generation.fetch_add(1);
+    worker.generation.notify_one();
+    if (worker.thread.joinable())
+        worker.thread.join();
+}
+
+bool postAiRequest(AiWorker& worker, const Game& game, const PlannerBudget& budget, int timeLimitMilliseconds)
+{
+    AiRequest request;
+    request.game = game;
+    request.generation = worker.nextGeneration + 1;
+    request.budget = budget;
+    request.timeLimitMilliseconds = timeLimitMilliseconds;
+    if (!worker.requests.push(request))
+        return false;
+
+    // Publishing the new generation is what cancels the search for the old one
+    ++worker.nextGeneration;
+    worker.generation.store(worker.nextGeneration);
+    worker.generation.notify_one();
+    return true;
+}
+
+void cancelAiRequests(AiWorker& worker)
+{
+    ++worker.nextGeneration;
+    worker.generation.store(worker.nextGeneration);
+    worker.generation.notify_one();
+}
+
+bool pollAiResult(AiWorker& worker, AiResult& result)
+{
+    while (worker.results.pop(result))
+    {
+        if (result.generation == worker.nextGeneration)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,96 @@
+#include "checksum.h"
+
+#include <cstring>
+
+const size_t BOARD_ROW_BYTES = sizeof(Board::rows);
+static_assert(BOARD_ROW_BYTES % sizeof(uint64_t) == 0, "The rows are hashed a word at a time");
+
+// Odd multipliers per word, so the words are hashed independently and swapping two of them still shows
+const uint64_t WORD_MULTIPLIERS[] = { 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull,
+    0xFF51AFD7ED558CCDull, 0xC4CEB9FE1A85EC53ull, 0x94D049BB133111EBull, 0xBF58476D1CE4E5B9ull };
+const int BOARD_WORDS = BOARD_ROW_BYTES / sizeof(uint64_t);
+
+static_assert(BOARD_WORDS + 2 <= sizeof(WORD_MULTIPLIERS) / sizeof(WORD_MULTIPLIERS[0]), "One multiplier per hashed word");
+
+uint64_t rollChecksum(uint64_t checksum, const Game& game)
+{
+    uint64_t words[BOARD_WORDS];
+    memcpy(words, game.board.rows, sizeof(words));
+
+    // Colors are cosmetic and not replicated, so the palette planes stay out
+    const Tetromino& piece = game.current;
+    uint64_t pose = (uint64_t)(uint8_t)piece.type | (uint64_t)(uint8_t)piece.rotation << 8 | (uint64_t)(uint16_t)piece.x << 16
+        | (uint64_t)(uint16_t)piece.y << 32;
+
+    // Independent multiplies rather than a chain, then one dependent step into the running value
+    uint64_t hash = pose * WORD_MULTIPLIERS[BOARD_WORDS] + game.rng.state * WORD_MULTIPLIERS[BOARD_WORDS + 1];
+    for (int i = 0; i < BOARD_WORDS; ++i)
+        hash += (words[i] ^ (words[i] >> 29)) * WORD_MULTIPLIERS[i];
+    checksum = (checksum ^ hash) * 0x9E3779B97F4A7C15ull;
+    return checksum ^ (checksum >> 32);
+}
+
+// Two words of queued attacks plus one of totals per player, then the rng
+const int GARBAGE_QUEUE_WORDS = GARBAGE_QUEUE_CAPACITY * 2 / sizeof(uint64_t);
+const int GARBAGE_WORDS = VERSUS_PLAYERS * (GARBAGE_QUEUE_WORDS + 1) + 1;
+
+static_assert(GARBAGE_WORDS <= sizeof(WORD_MULTIPLIERS) / sizeof(WORD_MULTIPLIERS[0]), "One multiplier per hashed word");
+
+uint64_t rollChecksum(uint64_t checksum, const VersusGarbage& garbage)
+{
+    uint64_t words[GARBAGE_WORDS] = {};
+    int word = 0;
+    for (const GarbageQueue& queue : garbage.queues)
+    {
+        // Oldest first from the head, so where the ring happens to start does not matter
+        for (int i = 0; i < queue.count; ++i)
+        {
+            int slot = (queue.head + i) & (GARBAGE_QUEUE_CAPACITY - 1);
+            uint64_t attack = (uint64_t)queue.lines[slot] | (uint64_t)queue.holes[slot] << 8;
+            words[word + i / 4] |= attack << (i % 4 * 16);
+        }
+        word += GARBAGE_QUEUE_WORDS;
+    }
+    for (int player = 0; player < VERSUS_PLAYERS; ++player)
+    {
+        const GarbageQueue& queue = garbage.queues[player];
+        words[word++] = (uint64_t)queue.count | (uint64_t)queue.pending << 8 | (uint64_t)garbage.linesSent[player] << 32;
+    }
+    words[word] = garbage.rng.state;
+
+    uint64_t hash = 0;
+    for (int i = 0; i < GARBAGE_WORDS; ++i)
+        hash += (words[i] ^ (words[i] >> 29)) * WORD_MULTIPLIERS[i];
+    checksum = (checksum ^ hash) * 0x9E3779B97F4A7C15ull;
+    return checksum ^ (checksum >> 32);
+}
+
+void dumpGame(FILE* file, const Game& game)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(game.current, blocks);
+
+    fprintf(file, "piece %d rotation %d at (%d, %d), rng %016llx, lines %d, pieces %d%s\n", game.current.type, game.current.rotation,
+        game.current.x, game.current.y, (unsigned long long)game.rng.state, game.linesCleared, game.piecesPlaced,
+        game.isGameOver ? ", game over" : "");
+    fprintf(file, "queue");
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        fprintf(file, " %d", game.queue[i]);
+    fprintf(file, "\n");
+
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        char line[BOARD_WIDTH + 1];
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            line[x] = isOccupied(game.board, x, y) ? '#' : '.';
+            for (const Block& block : blocks)
+            {
+                if (block.x == x && block.y == y)
+                    line[x] = '@';
+            }
+        }
+        line[BOARD_WIDTH] = '\0';
+        fprintf(file, "%s\n", line);
+    }
+}
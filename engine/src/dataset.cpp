@@ -0,0 +1,215 @@
+#include "dataset.h"
+#include "varint.h"
+
+#include <cstring>
+
+static_assert(sizeof(DatasetHeader) == 32, "DatasetHeader is written to disk as is");
+static_assert(sizeof(DatasetChunkEntry) == 16, "DatasetChunkEntry is written to disk as is");
+
+const uint8_t RECORD_GAME_OVER = 0x01;
+const int RECORD_LINES_SHIFT = 1;
+const int QUEUE_BITS_PER_PIECE = 3;
+
+static bool flushChunk(DatasetWriter& writer)
+{
+    if (writer.chunkRecords == 0)
+        return true;
+
+    DatasetChunkEntry entry;
+    entry.offset = writer.offset;
+    entry.size = (uint32_t)writer.chunk.size();
+    entry.recordCount = writer.chunkRecords;
+    if (fwrite(writer.chunk.data(), 1, writer.chunk.size(), writer.file) != writer.chunk.size())
+        return false;
+    writer.offset += entry.size;
+
+    writer.index.push_back(entry);
+    writer.chunk.clear();
+    writer.chunkRecords = 0;
+    return true;
+}
+
+bool openDatasetWriter(DatasetWriter& writer, const char* path)
+{
+    writer.file = fopen(path, "wb");
+    if (writer.file == nullptr)
+        return false;
+
+    memset(&writer.header, 0, sizeof(writer.header));
+    memcpy(writer.header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+    writer.header.version = DATASET_VERSION;
+    writer.header.boardWidth = BOARD_WIDTH;
+    writer.header.boardHeight = BOARD_HEIGHT;
+    writer.header.queueSize = NEXT_QUEUE_SIZE;
+    writer.chunk.clear();
+    writer.chunkRecords = 0;
+    writer.index.clear();
+    writer.offset = sizeof(writer.header);
+
+    // Placeholder, rewritten once the index offset is known
+    return fwrite(&writer.header, sizeof(writer.header), 1, writer.file) == 1;
+}
+
+bool writeDatasetRecord(DatasetWriter& writer, const DatasetRecord& record)
+{
+    if (writer.chunkRecords == 0)
+        clearBoard(writer.previousBoard);
+
+    uint8_t bytes[3 + MAX_VARINT_BYTES * (BOARD_HEIGHT + 2)];
+    int size = 0;
+
+    bytes[size++] = (uint8_t)((record.isGameOver ? RECORD_GAME_OVER : 0) | (record.linesCleared << RECORD_LINES_SHIFT));
+    bytes[size++] = record.pieceType;
+    bytes[size++] = record.action;
+
+    uint64_t queue = 0;
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        queue |= (uint64_t)record.queue[i] << (i * QUEUE_BITS_PER_PIECE);
+    size += writeVarint(bytes + size, queue);
+
+    // Bit y of the mask marks rows that differ from the previous record, followed by their xor
+    uint64_t changedRows = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (record.board.rows[y] != writer.previousBoard.rows[y])
+            changedRows |= 1ull << y;
+    }
+    size += writeVarint(bytes + size, changedRows);
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (changedRows & (1ull << y))
+            size += writeVarint(bytes + size, record.board.rows[y] ^ writer.previousBoard.rows[y]);
+    }
+
+    writer.chunk.insert(writer.chunk.end(), bytes, bytes + size);
+    writer.previousBoard = record.board;
+    writer.header.recordCount++;
+    if (++writer.chunkRecords == DATASET_CHUNK_RECORDS)
+        return flushChunk(writer);
+    return true;
+}
+
+bool closeDatasetWriter(DatasetWriter& writer)
+{
+    if (writer.file == nullptr)
+        return false;
+
+    bool isOk = flushChunk(writer);
+
+    // Chunks are byte streams of any length, so pad the index out to where its entries can be read in place
+    static const uint8_t padding[alignof(DatasetChunkEntry)] = {};
+    size_t paddingSize = (alignof(DatasetChunkEntry) - writer.offset % alignof(DatasetChunkEntry)) % alignof(DatasetChunkEntry);
+    isOk = isOk && fwrite(padding, 1, paddingSize, writer.file) == paddingSize;
+    writer.offset += paddingSize;
+
+    writer.header.chunkCount = (uint32_t)writer.index.size();
+    writer.header.indexOffset = writer.offset;
+
+    isOk = isOk && (writer.index.empty() || fwrite(writer.index.data(), sizeof(DatasetChunkEntry), writer.index.size(), writer.file) == writer.index.size());
+    isOk = isOk && fseek(writer.file, 0, SEEK_SET) == 0;
+    isOk = isOk && fwrite(&writer.header, sizeof(writer.header), 1, writer.file) == 1;
+    isOk = fclose(writer.file) == 0 && isOk;
+    writer.file = nullptr;
+    return isOk;
+}
+
+bool openDatasetReader(DatasetReader& reader, const char* path)
+{
+    reader.header = nullptr;
+    reader.index.clear();
+    if (!mapFile(path, reader.file))
+        return false;
+
+    const DatasetHeader* header = (const DatasetHeader*)reader.file.data;
+    bool isValid = reader.file.size >= sizeof(DatasetHeader)
+        && memcmp(header->magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) == 0
+        && header->version == DATASET_VERSION
+        && header->boardWidth == BOARD_WIDTH
+        && header->boardHeight == BOARD_HEIGHT
+        && header->queueSize == NEXT_QUEUE_SIZE
+        && header->indexOffset <= reader.file.size
+        && (reader.file.size - header->indexOffset) / sizeof(DatasetChunkEntry) >= header->chunkCount;
+    if (!isValid)
+    {
+        unmapFile(reader.file);
+        return false;
+    }
+
+    // Files from before the index was padded can leave it anywhere, so copy it out rather than point into the mapping
+    reader.header = header;
+    reader.index.resize(header->chunkCount);
+    if (header->chunkCount > 0)
+        memcpy(reader.index.data(), reader.file.data + header->indexOffset, sizeof(DatasetChunkEntry) * header->chunkCount);
+    return true;
+}
+
+void closeDatasetReader(DatasetReader& reader)
+{
+    unmapFile(reader.file);
+    reader.header = nullptr;
+    reader.index.clear();
+}
+
+bool decodeDatasetChunk(const DatasetReader& reader, uint32_t chunk, std::vector<DatasetRecord>& records)
+{
+    records.clear();
+    if (chunk >= reader.header->chunkCount)
+        return false;
+
+    const DatasetChunkEntry& entry = reader.index[chunk];
+    if (entry.offset + entry.size > reader.header->indexOffset)
+        return false;
+
+    const uint8_t* in = reader.file.data + entry.offset;
+    size_t remaining = entry.size;
+
+    Board board;
+    clearBoard(board);
+    records.reserve(entry.recordCount);
+    for (uint32_t i = 0; i < entry.recordCount; ++i)
+    {
+        if (remaining < 3)
+            return false;
+
+        DatasetRecord record;
+        record.isGameOver = (in[0] & RECORD_GAME_OVER) != 0;
+        record.linesCleared = in[0] >> RECORD_LINES_SHIFT;
+        record.pieceType = in[1];
+        record.action = in[2];
+        in += 3;
+        remaining -= 3;
+
+        uint64_t queue;
+        int used = readVarint(in, remaining, queue);
+        if (used == 0)
+            return false;
+        in += used;
+        remaining -= used;
+        for (int q = 0; q < NEXT_QUEUE_SIZE; ++q)
+            record.queue[q] = (uint8_t)((queue >> (q * QUEUE_BITS_PER_PIECE)) & ((1u << QUEUE_BITS_PER_PIECE) - 1));
+
+        uint64_t changedRows;
+        used = readVarint(in, remaining, changedRows);
+        if (used == 0)
+            return false;
+        in += used;
+        remaining -= used;
+        for (int y = 0; y < BOARD_HEIGHT; ++y)
+        {
+            if ((changedRows & (1ull << y)) == 0)
+                continue;
+
+            uint64_t delta;
+            used = readVarint(in, remaining, delta);
+            if (used == 0)
+                return false;
+            in += used;
+            remaining -= used;
+            board.rows[y] ^= (Row)delta;
+        }
+
+        record.board = board;
+        records.push_back(record);
+    }
+    return true;
+}
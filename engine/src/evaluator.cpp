@@ -0,0 +1,124 @@
+#include "evaluator.h"
+
+#include <bit>
+#include <cstring>
+
+const float HEIGHT_WEIGHT = -0.510066f;
+const float LINES_WEIGHT = 0.760666f;
+const float HOLES_WEIGHT = -0.35663f;
+const float BUMPINESS_WEIGHT = -0.184483f;
+const float SPIN_WEIGHT = 0.35f; // Per line cleared by a spin, on top of LINES_WEIGHT
+
+void getColumnHeights(const Board& board, int heights[BOARD_WIDTH])
+{
+    for (int x = 0; x < BOARD_WIDTH; ++x)
+        heights[x] = 0;
+
+    Row seen = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        Row fresh = board.rows[y] & ~seen;
+        while (fresh)
+        {
+            int x = std::countr_zero((unsigned)fresh);
+            heights[x] = BOARD_HEIGHT - y;
+            fresh &= fresh - 1;
+        }
+        seen |= board.rows[y];
+    }
+}
+
+int countHoles(const Board& board)
+{
+    // An empty cell is a hole when any row above it is filled in the same column
+    int holes = 0;
+    Row covered = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        holes += std::popcount((unsigned)(covered & ~board.rows[y] & FULL_ROW));
+        covered |= board.rows[y];
+    }
+    return holes;
+}
+
+void HeuristicEvaluator::evaluate(const Candidate* candidates, int count, float* scores)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const Board& board = candidates[i].board;
+        int heights[BOARD_WIDTH];
+        getColumnHeights(board, heights);
+
+        int aggregateHeight = 0;
+        int bumpiness = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            aggregateHeight += heights[x];
+            if (x > 0)
+                bumpiness += heights[x] > heights[x - 1] ? heights[x] - heights[x - 1] : heights[x - 1] - heights[x];
+        }
+
+        scores[i] = HEIGHT_WEIGHT * aggregateHeight
+            + LINES_WEIGHT * candidates[i].linesCleared
+            + HOLES_WEIGHT * countHoles(board)
+            + BUMPINESS_WEIGHT * bumpiness
+            + (candidates[i].spin != SPIN_NONE ? SPIN_WEIGHT * candidates[i].linesCleared : 0.0f);
+    }
+}
+
+int enumerateCandidates(const Game& game, Candidate candidates[MAX_CANDIDATES])
+{
+    if (game.isGameOver)
+        return 0;
+
+    Board locked[MAX_CANDIDATES];
+    int count = 0;
+    int rotations = game.current.type == PIECE_SQUARE ? 1 : ROTATION_COUNT;
+    for (int rotation = 0; rotation < rotations; ++rotation)
+    {
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            Candidate& candidate = candidates[count];
+            candidate.placement = { rotation, x };
+            if (!findPlacement(game, candidate.placement, candidate.tetromino))
+                continue;
+
+            locked[count] = game.board;
+            placeTetromino(candidate.tetromino, locked[count]);
+
+            // Different inputs can land on the same cells; keep only the first
+            bool isDuplicate = false;
+            for (int i = 0; i < count && !isDuplicate; ++i)
+                isDuplicate = memcmp(locked[i].rows, locked[count].rows, sizeof(Board::rows)) == 0;
+            if (isDuplicate)
+                continue;
+
+            // Placements end with the drop, so this rates the slot rather than the route that reached it
+            candidate.spin = detectSpin(game.board, candidate.tetromino, true);
+            candidate.board = locked[count];
+            candidate.linesCleared = clearFullLines(candidate.board);
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool choosePlacement(const Game& game, Evaluator& evaluator, Placement& placement)
+{
+    Candidate candidates[MAX_CANDIDATES];
+    int count = enumerateCandidates(game, candidates);
+    if (count == 0)
+        return false;
+
+    float scores[MAX_CANDIDATES];
+    evaluator.evaluate(candidates, count, scores);
+
+    int best = 0;
+    for (int i = 1; i < count; ++i)
+    {
+        if (scores[i] > scores[best])
+            best = i;
+    }
+    placement = candidates[best].placement;
+    return true;
+}
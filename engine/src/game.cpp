@@ -0,0 +1,481 @@
+#include "game.h"
+#include "spin.h"
+
+#include <cstring>
+
+// Block offsets from the pivot at spawn, taken from the original piece layouts
+static constexpr Block SPAWN_OFFSETS[PIECE_TYPE_COUNT][TETROMINO_SIZE] =
+{
+    { {-1, 0}, {0, 0}, {1, 0}, {2, 0} },  // Line
+    { {0, 0}, {1, 0}, {0, 1}, {1, 1} },   // Square
+    { {-1, 0}, {0, 0}, {1, 0}, {0, 1} },  // T-shape
+    { {-1, 0}, {0, 0}, {1, 0}, {-1, 1} }, // L-shape
+    { {-1, 0}, {0, 0}, {1, 0}, {1, 1} },  // Reverse L-shape
+};
+
+static const int SPAWN_X_FROM_CENTER[PIECE_TYPE_COUNT] = { 0, -1, 0, 0, 0 };
+
+// Points per lock by spin and lines cleared, following the guideline table
+static const int LINE_SCORES[SPIN_TYPE_COUNT][TETROMINO_SIZE + 1] =
+{
+    { 0, 100, 300, 500, 800 },     // Plain
+    { 100, 200, 400, 800, 1200 },  // Mini and all-spins
+    { 400, 800, 1200, 1600, 2000 }, // T-spins
+};
+
+struct KickList
+{
+    int count;
+    Kick kicks[MAX_KICKS];
+};
+
+enum KickClass
+{
+    KICK_CLASS_DEFAULT,
+    KICK_CLASS_LINE,
+    KICK_CLASS_COUNT
+};
+
+static const int KICK_CLASSES[PIECE_TYPE_COUNT] = { KICK_CLASS_LINE, KICK_CLASS_DEFAULT, KICK_CLASS_DEFAULT, KICK_CLASS_DEFAULT, KICK_CLASS_DEFAULT };
+
+// Kicks for each rotation system and piece class, indexed by the rotation being turned from. The SRS rows
+// are the guideline tables with y pointing down; T and both Ls spawn pointing down, so this engine's
+// rotation r is guideline state (r + 2) % 4 for them, while the line's states line up as they are.
+static constexpr KickList KICKS[ROTATION_SYSTEM_COUNT][KICK_CLASS_COUNT][ROTATION_COUNT] =
+{
+    { // None
+        { { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } } },
+        { { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } } },
+    },
+    { // SRS
+        {
+            { 5, { {0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2} } },     // 2 -> L
+            { 5, { {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2} } }, // L -> 0
+            { 5, { {0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2} } },  // 0 -> R
+            { 5, { {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2} } },    // R -> 2
+        },
+        {
+            { 5, { {0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2} } }, // 0 -> R
+            { 5, { {0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1} } }, // R -> 2
+            { 5, { {0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2} } }, // 2 -> L
+            { 5, { {0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1} } }, // L -> 0
+        },
+    },
+    { // ARS
+        { { 3, { {0, 0}, {1, 0}, {-1, 0} } }, { 3, { {0, 0}, {1, 0}, {-1, 0} } }, { 3, { {0, 0}, {1, 0}, {-1, 0} } }, { 3, { {0, 0}, {1, 0}, {-1, 0} } } },
+        { { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } } },
+    },
+};
+
+static const char* const ROTATION_SYSTEM_NAMES[ROTATION_SYSTEM_COUNT] = { "none", "srs", "ars" };
+
+static RotationSystem rotationSystem = ROTATION_SRS;
+
+static constexpr Block rotateOffset(Block offset, int rotation)
+{
+    for (int r = 0; r < rotation; ++r)
+        offset = { -offset.y, offset.x };
+    return offset;
+}
+
+static constexpr PieceMask makePieceMask(int type, int rotation)
+{
+    PieceMask mask = {};
+    int top = TETROMINO_SIZE, left = TETROMINO_SIZE, bottom = -TETROMINO_SIZE;
+    for (const Block& offset : SPAWN_OFFSETS[type])
+    {
+        Block block = rotateOffset(offset, rotation);
+        top = block.y < top ? block.y : top;
+        left = block.x < left ? block.x : left;
+        bottom = block.y > bottom ? block.y : bottom;
+    }
+    for (const Block& offset : SPAWN_OFFSETS[type])
+    {
+        Block block = rotateOffset(offset, rotation);
+        mask.rows[block.y - top] |= (uint8_t)(1u << (block.x - left));
+    }
+    mask.top = (int8_t)top;
+    mask.left = (int8_t)left;
+    mask.height = (int8_t)(bottom - top + 1);
+    return mask;
+}
+
+struct PieceMaskTable
+{
+    PieceMask masks[PIECE_TYPE_COUNT][ROTATION_COUNT];
+};
+
+static constexpr PieceMaskTable makePieceMaskTable()
+{
+    PieceMaskTable table = {};
+    for (int type = 0; type < PIECE_TYPE_COUNT; ++type)
+    {
+        for (int rotation = 0; rotation < ROTATION_COUNT; ++rotation)
+            table.masks[type][rotation] = makePieceMask(type, rotation);
+    }
+    return table;
+}
+
+static constexpr PieceMaskTable PIECE_MASKS = makePieceMaskTable();
+
+void setRotationSystem(RotationSystem system)
+{
+    rotationSystem = system;
+}
+
+RotationSystem getRotationSystem()
+{
+    return rotationSystem;
+}
+
+const char* getRotationSystemName(RotationSystem system)
+{
+    return ROTATION_SYSTEM_NAMES[system];
+}
+
+bool findRotationSystem(const char* name, RotationSystem& system)
+{
+    for (int i = 0; i < ROTATION_SYSTEM_COUNT; ++i)
+    {
+        if (strcmp(name, ROTATION_SYSTEM_NAMES[i]) == 0)
+        {
+            system = (RotationSystem)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const Kick* getKicks(int type, int rotation, int& count)
+{
+    const KickList& kicks = KICKS[rotationSystem][KICK_CLASSES[type]][rotation];
+    count = kicks.count;
+    return kicks.kicks;
+}
+
+void seedRng(Rng& rng, uint64_t seed)
+{
+    // splitmix64 so that neighbouring seeds still give unrelated sequences
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    rng.state = z ? z : 1;
+}
+
+uint32_t nextRandom(Rng& rng)
+{
+    // xorshift64*
+    rng.state ^= rng.state >> 12;
+    rng.state ^= rng.state << 25;
+    rng.state ^= rng.state >> 27;
+    return (uint32_t)((rng.state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+template <int Width, int Height>
+void clearBoard(BasicBoard<Width, Height>& board)
+{
+    memset(board.rows, 0, sizeof(board.rows));
+    memset(board.palette, 0, sizeof(board.palette));
+}
+
+template <int Width, int Height>
+bool isOccupied(const BasicBoard<Width, Height>& board, int x, int y)
+{
+    return (board.rows[y] >> x) & 1;
+}
+
+template <int Width, int Height>
+int getCellPalette(const BasicBoard<Width, Height>& board, int x, int y)
+{
+    int entry = 0;
+    for (int b = 0; b < PALETTE_BITS; ++b)
+        entry |= ((board.palette[b][y] >> x) & 1) << b;
+    return entry;
+}
+
+Tetromino createTetromino(int type, int boardWidth)
+{
+    Tetromino tetromino;
+    tetromino.type = type;
+    tetromino.rotation = 0;
+    tetromino.x = boardWidth / 2 + SPAWN_X_FROM_CENTER[type];
+    tetromino.y = SPAWN_Y;
+    return tetromino;
+}
+
+void getBlocks(const Tetromino& tetromino, Block blocks[TETROMINO_SIZE])
+{
+    for (int i = 0; i < TETROMINO_SIZE; ++i)
+    {
+        int relativeX = SPAWN_OFFSETS[tetromino.type][i].x;
+        int relativeY = SPAWN_OFFSETS[tetromino.type][i].y;
+
+        // Apply 90-degree rotation transformation once per quarter turn
+        for (int r = 0; r < tetromino.rotation; ++r)
+        {
+            int rotatedX = -relativeY;
+            int rotatedY = relativeX;
+            relativeX = rotatedX;
+            relativeY = rotatedY;
+        }
+
+        blocks[i].x = tetromino.x + relativeX;
+        blocks[i].y = tetromino.y + relativeY;
+    }
+}
+
+const PieceMask& getPieceMask(int type, int rotation)
+{
+    return PIECE_MASKS.masks[type][rotation];
+}
+
+template <int Width, int Height>
+bool collidesAt(const BasicBoard<Width, Height>& board, const PieceMask& mask, int x, int y)
+{
+    typedef typename BasicBoard<Width, Height>::PaddedRow PaddedRow;
+
+    // Far enough out that the mask would leave the padded row is past a wall anyway
+    int shift = x + mask.left + PIECE_MASK_PAD;
+    if (shift < 0 || shift > (int)sizeof(PaddedRow) * 8 - TETROMINO_SIZE)
+        return true;
+
+    int top = y + mask.top;
+    PaddedRow overlap = 0;
+    for (int row = 0; row < mask.height; ++row)
+        overlap |= getPaddedRow(board, top + row) & (PaddedRow)((PaddedRow)mask.rows[row] << shift);
+    return overlap != 0;
+}
+
+template <int Width, int Height>
+bool checkCollision(const Tetromino& tetromino, const BasicBoard<Width, Height>& board)
+{
+    return collidesAt(board, getPieceMask(tetromino.type, tetromino.rotation), tetromino.x, tetromino.y);
+}
+
+template <int Width, int Height>
+bool moveTetromino(Tetromino& tetromino, int dx, int dy, const BasicBoard<Width, Height>& board)
+{
+    Tetromino movedTetromino = tetromino;
+    movedTetromino.x += dx;
+    movedTetromino.y += dy;
+    if (checkCollision(movedTetromino, board))
+        return false;
+
+    tetromino = movedTetromino;
+    return true;
+}
+
+template <int Width, int Height>
+bool rotateTetromino(Tetromino& tetromino, const BasicBoard<Width, Height>& board)
+{
+    if (tetromino.type == PIECE_SQUARE)
+        return false; // No rotation for square
+
+    // One masked test per kick against the rotated shape; the first that fits wins
+    int rotation = (tetromino.rotation + 1) % ROTATION_COUNT;
+    const PieceMask& mask = PIECE_MASKS.masks[tetromino.type][rotation];
+    const KickList& kicks = KICKS[rotationSystem][KICK_CLASSES[tetromino.type]][tetromino.rotation];
+    for (int i = 0; i < kicks.count; ++i)
+    {
+        int x = tetromino.x + kicks.kicks[i].x;
+        int y = tetromino.y + kicks.kicks[i].y;
+        if (!collidesAt(board, mask, x, y))
+        {
+            tetromino.rotation = rotation;
+            tetromino.x = x;
+            tetromino.y = y;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int Width, int Height>
+void dropTetromino(Tetromino& tetromino, const BasicBoard<Width, Height>& board)
+{
+    while (moveTetromino(tetromino, 0, 1, board))
+    {
+    }
+}
+
+template <int Width, int Height>
+void placeTetromino(const Tetromino& tetromino, BasicBoard<Width, Height>& board)
+{
+    typedef typename BasicBoard<Width, Height>::Row BoardRow;
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (const Block& block : blocks)
+    {
+        if (block.y < 0)
+            continue;
+
+        BoardRow bit = (BoardRow)(1ull << block.x);
+        board.rows[block.y] |= bit;
+        // Written whole, since cells emptied outside the rules may have left stale bits behind
+        for (int b = 0; b < PALETTE_BITS; ++b)
+            board.palette[b][block.y] = (BoardRow)((board.palette[b][block.y] & ~bit) | ((tetromino.type >> b) & 1 ? bit : 0));
+    }
+}
+
+template <int Width, int Height>
+int clearFullLines(BasicBoard<Width, Height>& board)
+{
+    // Compact the surviving rows towards the bottom, then clear what is left at the top
+    int target = Height - 1;
+    for (int y = Height - 1; y >= 0; --y)
+    {
+        if (board.rows[y] != BasicBoard<Width, Height>::FULL_ROW)
+        {
+            for (int b = 0; b < PALETTE_BITS; ++b)
+                board.palette[b][target] = board.palette[b][y];
+            board.rows[target--] = board.rows[y];
+        }
+    }
+
+    int cleared = target + 1;
+    for (int y = target; y >= 0; --y)
+    {
+        board.rows[y] = 0;
+        for (int b = 0; b < PALETTE_BITS; ++b)
+            board.palette[b][y] = 0;
+    }
+
+    return cleared;
+}
+
+template <int Width, int Height>
+static void spawnNextTetromino(BasicGame<Width, Height>& game)
+{
+    game.current = createTetromino(game.queue[0], Width);
+    for (int i = 1; i < NEXT_QUEUE_SIZE; ++i)
+        game.queue[i - 1] = game.queue[i];
+    game.queue[NEXT_QUEUE_SIZE - 1] = nextRandom(game.rng) % PIECE_TYPE_COUNT;
+
+    if (checkCollision(game.current, game.board))
+        game.isGameOver = true;
+}
+
+template <int Width, int Height>
+void resetGame(BasicGame<Width, Height>& game, uint64_t seed)
+{
+    seedRng(game.rng, seed);
+    clearBoard(game.board);
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        game.queue[i] = nextRandom(game.rng) % PIECE_TYPE_COUNT;
+    game.linesCleared = 0;
+    game.piecesPlaced = 0;
+    game.score = 0;
+    game.lastSpin = SPIN_NONE;
+    game.isLastMoveRotation = false;
+    game.isGameOver = false;
+    spawnNextTetromino(game);
+}
+
+template <int Width, int Height>
+int lockTetromino(BasicGame<Width, Height>& game)
+{
+    // Spins are judged against the board the piece landed in, before it fills anything
+    game.lastSpin = detectSpin(game.board, game.current, game.isLastMoveRotation);
+    game.isLastMoveRotation = false;
+
+    placeTetromino(game.current, game.board);
+    int lines = clearFullLines(game.board);
+    game.linesCleared += lines;
+    game.score += LINE_SCORES[game.lastSpin][lines];
+    game.piecesPlaced++;
+    spawnNextTetromino(game);
+    return lines;
+}
+
+template <int Width, int Height>
+void applyGravity(BasicGame<Width, Height>& game)
+{
+    if (moveTetromino(game.current, 0, 1, game.board))
+        game.isLastMoveRotation = false;
+    else
+        lockTetromino(game);
+}
+
+template <int Width, int Height>
+void insertGarbageRows(BasicGame<Width, Height>& game, int count, int holeColumn)
+{
+    typedef typename BasicBoard<Width, Height>::Row BoardRow;
+    if (count > Height)
+        count = Height;
+
+    BasicBoard<Width, Height>& board = game.board;
+    for (int y = 0; y < count; ++y)
+        game.isGameOver |= board.rows[y] != 0;
+
+    // The rows are a few bytes each, so shifting them all is one small move
+    memmove(board.rows, board.rows + count, sizeof(BoardRow) * (Height - count));
+    BoardRow garbage = (BoardRow)(BasicBoard<Width, Height>::FULL_ROW & ~(1ull << holeColumn));
+    for (int y = Height - count; y < Height; ++y)
+        board.rows[y] = garbage;
+    for (int b = 0; b < PALETTE_BITS; ++b)
+    {
+        memmove(board.palette[b], board.palette[b] + count, sizeof(BoardRow) * (Height - count));
+        for (int y = Height - count; y < Height; ++y)
+            board.palette[b][y] = (PALETTE_GARBAGE >> b) & 1 ? garbage : 0;
+    }
+
+    // The falling piece rides up with the stack
+    for (int lifted = 0; lifted < count && checkCollision(game.current, board); ++lifted)
+        --game.current.y;
+    game.isGameOver |= checkCollision(game.current, board);
+}
+
+template <int Width, int Height>
+bool findPlacement(const BasicGame<Width, Height>& game, const Placement& placement, Tetromino& result)
+{
+    // Follow the same inputs a player would use: rotate in place, shift sideways, then drop
+    Tetromino tetromino = game.current;
+    while (tetromino.rotation != placement.rotation && tetromino.type != PIECE_SQUARE)
+    {
+        if (!rotateTetromino(tetromino, game.board))
+            return false;
+    }
+
+    int dx = placement.x > tetromino.x ? 1 : -1;
+    while (tetromino.x != placement.x)
+    {
+        if (!moveTetromino(tetromino, dx, 0, game.board))
+            return false;
+    }
+
+    dropTetromino(tetromino, game.board);
+    result = tetromino;
+    return true;
+}
+
+template <int Width, int Height>
+int applyPlacement(BasicGame<Width, Height>& game, const Placement& placement)
+{
+    if (game.isGameOver || !findPlacement(game, placement, game.current))
+        return -1;
+
+    game.isLastMoveRotation = false; // Placements always end with the drop
+
+    return lockTetromino(game);
+}
+
+#define INSTANTIATE_RULES(Width, Height) \
+    template void clearBoard(BasicBoard<Width, Height>&); \
+    template bool isOccupied(const BasicBoard<Width, Height>&, int, int); \
+    template int getCellPalette(const BasicBoard<Width, Height>&, int, int); \
+    template bool collidesAt(const BasicBoard<Width, Height>&, const PieceMask&, int, int); \
+    template bool checkCollision(const Tetromino&, const BasicBoard<Width, Height>&); \
+    template bool moveTetromino(Tetromino&, int, int, const BasicBoard<Width, Height>&); \
+    template bool rotateTetromino(Tetromino&, const BasicBoard<Width, Height>&); \
+    template void dropTetromino(Tetromino&, const BasicBoard<Width, Height>&); \
+    template void placeTetromino(const Tetromino&, BasicBoard<Width, Height>&); \
+    template int clearFullLines(BasicBoard<Width, Height>&); \
+    template void resetGame(BasicGame<Width, Height>&, uint64_t); \
+    template int lockTetromino(BasicGame<Width, Height>&); \
+    template void applyGravity(BasicGame<Width, Height>&); \
+    template void insertGarbageRows(BasicGame<Width, Height>&, int, int); \
+    template bool findPlacement(const BasicGame<Width, Height>&, const Placement&, Tetromino&); \
+    template int applyPlacement(BasicGame<Width, Height>&, const Placement&);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_RULES)
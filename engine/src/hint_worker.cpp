@@ -0,0 +1,92 @@
+#include "hint_worker.h"
+
+static_assert(HINT_PIECE_COUNT == OPENING_QUEUE_SIZE, "Book entries are keyed on the same pieces a hint uses");
+
+// Only an older generation is stale: a request is queued before its generation is published, so the
+// worker can see it while generation still holds the previous one
+static bool isStale(const HintWorker& worker, uint32_t generation)
+{
+    return worker.isStopping.load(std::memory_order_relaxed) || (int32_t)(worker.generation.load(std::memory_order_relaxed) - generation) > 0;
+}
+
+static void runHintWorker(HintWorker& worker)
+{
+    uint32_t seenGeneration = worker.generation.load();
+    while (!worker.isStopping.load())
+    {
+        HintRequest request;
+        if (!worker.requests.pop(request))
+        {
+            // Sleep until the game thread posts or cancels something
+            worker.generation.wait(seenGeneration);
+            seenGeneration = worker.generation.load();
+            continue;
+        }
+
+        // A newer request is already queued behind this one
+        if (isStale(worker, request.generation))
+            continue;
+
+        // The solver cannot be interrupted, so a solve that went stale meanwhile is simply not published
+        HintResult result;
+        result.generation = request.generation;
+        if (!(worker.book != nullptr && findOpening(*worker.book, request.board, request.pieces, result.solution))
+            && !solvePerfectClear(worker.solver, request.board, request.pieces, HINT_PIECE_COUNT, HINT_MAX_HEIGHT, worker.threadCount, result.solution))
+            result.solution.count = 0;
+        if (!isStale(worker, request.generation))
+            worker.results.push(result);
+    }
+}
+
+void startHintWorker(HintWorker& worker, const OpeningBook* book, int threadCount)
+{
+    worker.generation = 0;
+    worker.isStopping = false;
+    worker.nextGeneration = 0;
+    worker.book = book;
+    worker.threadCount = threadCount > 0 ? threadCount : 1;
+    worker.thread = std::thread(runHintWorker, std::ref(worker));
+}
+
+void stopHintWorker(HintWorker& worker)
+{
+    worker.isStopping = true;
+    worker.generation.fetch_add(1);
+    worker.generation.notify_one();
+    if (worker.thread.joinable())
+        worker.thread.join();
+}
+
+bool postHintRequest(HintWorker& worker, const Board& board, const int* pieces)
+{
+    HintRequest request;
+    request.board = board;
+    for (int i = 0; i < HINT_PIECE_COUNT; ++i)
+        request.pieces[i] = pieces[i];
+    request.generation = worker.nextGeneration + 1;
+    if (!worker.requests.push(request))
+        return false;
+
+    // Publishing the new generation is what makes the queued requests before it stale
+    ++worker.nextGeneration;
+    worker.generation.store(worker.nextGeneration);
+    worker.generation.notify_one();
+    return true;
+}
+
+void cancelHintRequests(HintWorker& worker)
+{
+    ++worker.nextGeneration;
+    worker.generation.store(worker.nextGeneration);
+    worker.generation.notify_one();
+}
+
+bool pollHintResult(HintWorker& worker, HintResult& result)
+{
+    while (worker.results.pop(result))
+    {
+        if (result.generation == worker.nextGeneration)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool mapFile(const char* path, MappedFile& file)
+{
+    file.data = nullptr;
+    file.size = 0;
+    file.fileHandle = -1;
+    file.mappingHandle = -1;
+
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    const void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    file.data = (const uint8_t*)view;
+    file.size = (size_t)size.QuadPart;
+    file.fileHandle = (intptr_t)fileHandle;
+    file.mappingHandle = (intptr_t)mappingHandle;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    file.data = (const uint8_t*)view;
+    file.size = (size_t)info.st_size;
+    file.fileHandle = fd;
+#endif
+    return true;
+}
+
+void unmapFile(MappedFile& file)
+{
+    if (file.data == nullptr)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE)file.mappingHandle);
+    CloseHandle((HANDLE)file.fileHandle);
+#else
+    munmap((void*)file.data, file.size);
+    close((int)file.fileHandle);
+#endif
+    file.data = nullptr;
+    file.size = 0;
+    file.fileHandle = -1;
+    file.mappingHandle = -1;
+}
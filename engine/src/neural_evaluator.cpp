@@ -0,0 +1,267 @@
+#include "neural_evaluator.h"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define NEURAL_HAS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+#define AVX2_TARGET
+#endif
+
+static_assert(sizeof(NeuralWeightsHeader) == 32, "NeuralWeightsHeader is read from disk as is");
+
+static bool cpuSupportsAvx2Fma()
+{
+#if defined(NEURAL_HAS_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool hasFma = (info[2] & (1 << 12)) != 0;
+    bool hasOsXsave = (info[2] & (1 << 27)) != 0;
+    if (!hasFma || !hasOsXsave || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(NEURAL_HAS_X86)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+// Same operations in the same order as runBatchAvx2, fused multiply-adds included, so a machine without
+// AVX2 scores bit for bit like one with it
+static void runBatchScalar(const NeuralEvaluator& evaluator, const NeuralBatch& batch, float* scores)
+{
+    const int hiddenSize = evaluator.hiddenSize;
+    float base[NEURAL_MAX_HIDDEN];
+    float accumulator[NEURAL_MAX_HIDDEN];
+
+    memcpy(base, evaluator.hiddenBias, sizeof(float) * hiddenSize);
+    for (int i = 0; i < batch.baseCount; ++i)
+    {
+        const float* column = evaluator.inputWeights + (size_t)batch.baseCells[i] * hiddenSize;
+        for (int h = 0; h < hiddenSize; ++h)
+            base[h] += column[h];
+    }
+
+    for (int c = 0; c < batch.count; ++c)
+    {
+        memcpy(accumulator, batch.isFromBase[c] ? base : evaluator.hiddenBias, sizeof(float) * hiddenSize);
+        for (int i = 0; i < batch.cellCount[c]; ++i)
+        {
+            const float* column = evaluator.inputWeights + (size_t)batch.cells[c][i] * hiddenSize;
+            for (int h = 0; h < hiddenSize; ++h)
+                accumulator[h] += column[h];
+        }
+        for (int f = 0; f < NEURAL_FEATURE_INPUTS; ++f)
+        {
+            const float* column = evaluator.inputWeights + (size_t)(NEURAL_CELL_INPUTS + f) * hiddenSize;
+            for (int h = 0; h < hiddenSize; ++h)
+                accumulator[h] = std::fma(batch.features[c][f], column[h], accumulator[h]);
+        }
+
+        // One running sum per lane, reduced pairwise like the AVX2 kernel, so both paths round alike
+        float sum[NEURAL_LANES] = {};
+        for (int h = 0; h < hiddenSize; h += NEURAL_LANES)
+        {
+            for (int lane = 0; lane < NEURAL_LANES; ++lane)
+            {
+                float activation = accumulator[h + lane] > 0.0f ? accumulator[h + lane] : 0.0f;
+                sum[lane] = std::fma(activation, evaluator.outputWeights[h + lane], sum[lane]);
+            }
+        }
+        for (int width = NEURAL_LANES / 2; width > 0; width /= 2)
+        {
+            for (int lane = 0; lane < width; ++lane)
+                sum[lane] += sum[lane + width];
+        }
+        scores[c] = evaluator.outputBias + sum[0];
+    }
+}
+
+#if defined(NEURAL_HAS_X86)
+AVX2_TARGET static void addColumnAvx2(float* accumulator, const float* column, int hiddenSize)
+{
+    for (int h = 0; h < hiddenSize; h += NEURAL_LANES)
+        _mm256_storeu_ps(accumulator + h, _mm256_add_ps(_mm256_loadu_ps(accumulator + h), _mm256_loadu_ps(column + h)));
+}
+
+AVX2_TARGET static void runBatchAvx2(const NeuralEvaluator& evaluator, const NeuralBatch& batch, float* scores)
+{
+    const int hiddenSize = evaluator.hiddenSize;
+    alignas(32) float base[NEURAL_MAX_HIDDEN];
+    alignas(32) float accumulator[NEURAL_MAX_HIDDEN];
+
+    memcpy(base, evaluator.hiddenBias, sizeof(float) * hiddenSize);
+    for (int i = 0; i < batch.baseCount; ++i)
+        addColumnAvx2(base, evaluator.inputWeights + (size_t)batch.baseCells[i] * hiddenSize, hiddenSize);
+
+    const __m256 zero = _mm256_setzero_ps();
+    for (int c = 0; c < batch.count; ++c)
+    {
+        memcpy(accumulator, batch.isFromBase[c] ? base : evaluator.hiddenBias, sizeof(float) * hiddenSize);
+        for (int i = 0; i < batch.cellCount[c]; ++i)
+            addColumnAvx2(accumulator, evaluator.inputWeights + (size_t)batch.cells[c][i] * hiddenSize, hiddenSize);
+
+        for (int f = 0; f < NEURAL_FEATURE_INPUTS; ++f)
+        {
+            const float* column = evaluator.inputWeights + (size_t)(NEURAL_CELL_INPUTS + f) * hiddenSize;
+            const __m256 feature = _mm256_set1_ps(batch.features[c][f]);
+            for (int h = 0; h < hiddenSize; h += NEURAL_LANES)
+                _mm256_store_ps(accumulator + h, _mm256_fmadd_ps(feature, _mm256_loadu_ps(column + h), _mm256_load_ps(accumulator + h)));
+        }
+
+        __m256 sum = zero;
+        for (int h = 0; h < hiddenSize; h += NEURAL_LANES)
+        {
+            __m256 activation = _mm256_max_ps(_mm256_load_ps(accumulator + h), zero);
+            sum = _mm256_fmadd_ps(activation, _mm256_loadu_ps(evaluator.outputWeights + h), sum);
+        }
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        scores[c] = evaluator.outputBias + _mm_cvtss_f32(half);
+    }
+}
+#endif
+
+NeuralEvaluator::NeuralEvaluator()
+{
+    file = { nullptr, 0, -1, -1 };
+    hiddenSize = 0;
+    inputWeights = nullptr;
+    hiddenBias = nullptr;
+    outputWeights = nullptr;
+    outputBias = 0.0f;
+    useAvx2 = cpuSupportsAvx2Fma();
+}
+
+NeuralEvaluator::~NeuralEvaluator()
+{
+    unmapFile(file);
+}
+
+bool NeuralEvaluator::load(const char* path)
+{
+    unmapFile(file);
+    hiddenSize = 0;
+    if (!mapFile(path, file))
+        return false;
+
+    const NeuralWeightsHeader* header = (const NeuralWeightsHeader*)file.data;
+    bool isValid = file.size >= sizeof(NeuralWeightsHeader)
+        && memcmp(header->magic, NEURAL_MAGIC, sizeof(NEURAL_MAGIC)) == 0
+        && header->version == NEURAL_VERSION
+        && header->inputSize == NEURAL_INPUT_SIZE
+        && header->hiddenSize > 0
+        && header->hiddenSize <= NEURAL_MAX_HIDDEN
+        && header->hiddenSize % NEURAL_LANES == 0;
+    size_t floatCount = isValid ? ((size_t)NEURAL_INPUT_SIZE + 2) * header->hiddenSize + 1 : 0;
+    if (!isValid || file.size < sizeof(NeuralWeightsHeader) + floatCount * sizeof(float))
+    {
+        unmapFile(file);
+        return false;
+    }
+
+    hiddenSize = (int)header->hiddenSize;
+    inputWeights = (const float*)(file.data + sizeof(NeuralWeightsHeader));
+    hiddenBias = inputWeights + (size_t)NEURAL_INPUT_SIZE * hiddenSize;
+    outputWeights = hiddenBias + hiddenSize;
+    outputBias = outputWeights[hiddenSize];
+    return true;
+}
+
+static void appendCells(const Board& board, uint16_t* cells, int& count)
+{
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        unsigned bits = board.rows[y];
+        while (bits)
+        {
+            int x = std::countr_zero(bits);
+            cells[count++] = (uint16_t)(y * BOARD_WIDTH + x);
+            bits &= bits - 1;
+        }
+    }
+}
+
+void NeuralEvaluator::evaluate(const Candidate* candidates, int count, float* scores)
+{
+    if (hiddenSize == 0)
+    {
+        for (int i = 0; i < count; ++i)
+            scores[i] = 0.0f;
+        return;
+    }
+
+    // Candidates that clear nothing are the shared pre-move board plus four cells,
+    // so accumulate that board once and only add each piece on top of it
+    Board base;
+    bool hasBase = false;
+    batch.count = count;
+    batch.baseCount = 0;
+    for (int c = 0; c < count; ++c)
+    {
+        const Candidate& candidate = candidates[c];
+        batch.isFromBase[c] = candidate.linesCleared == 0;
+        batch.cellCount[c] = 0;
+
+        if (batch.isFromBase[c])
+        {
+            Block blocks[TETROMINO_SIZE];
+            getBlocks(candidate.tetromino, blocks);
+            if (!hasBase)
+                base = candidate.board;
+            for (const Block& block : blocks)
+            {
+                if (block.y < 0)
+                    continue;
+                batch.cells[c][batch.cellCount[c]++] = (uint16_t)(block.y * BOARD_WIDTH + block.x);
+                if (!hasBase)
+                    base.rows[block.y] &= (Row)~(1u << block.x);
+            }
+            if (!hasBase)
+                appendCells(base, batch.baseCells, batch.baseCount);
+            hasBase = true;
+        }
+        else
+        {
+            appendCells(candidate.board, batch.cells[c], batch.cellCount[c]);
+        }
+
+        int heights[BOARD_WIDTH];
+        getColumnHeights(candidate.board, heights);
+        int aggregateHeight = 0;
+        int bumpiness = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            batch.features[c][x] = (float)heights[x];
+            aggregateHeight += heights[x];
+            if (x > 0)
+                bumpiness += heights[x] > heights[x - 1] ? heights[x] - heights[x - 1] : heights[x - 1] - heights[x];
+        }
+        batch.features[c][BOARD_WIDTH] = (float)countHoles(candidate.board);
+        batch.features[c][BOARD_WIDTH + 1] = (float)bumpiness;
+        batch.features[c][BOARD_WIDTH + 2] = (float)candidate.linesCleared;
+        batch.features[c][BOARD_WIDTH + 3] = (float)aggregateHeight;
+    }
+
+#if defined(NEURAL_HAS_X86)
+    if (useAvx2)
+    {
+        runBatchAvx2(*this, batch, scores);
+        return;
+    }
+#endif
+    runBatchScalar(*this, batch, scores);
+}
@@ -0,0 +1,146 @@
+#include "opening_book.h"
+#include "symmetry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(OpeningHeader) == 32, "OpeningHeader is written to disk as is");
+static_assert(sizeof(OpeningEntry) == 40, "OpeningEntry is written to disk as is");
+
+const int QUEUE_BITS_PER_PIECE = 3;
+
+static bool isBefore(const OpeningEntry& entry, uint64_t boardKey, uint32_t queueKey)
+{
+    return entry.boardKey < boardKey || (entry.boardKey == boardKey && entry.queueKey < queueKey);
+}
+
+bool getOpeningBoardKey(const Board& board, uint64_t& key)
+{
+    for (int y = 0; y < BOARD_HEIGHT - PC_MAX_HEIGHT; ++y)
+    {
+        if (board.rows[y] != 0)
+            return false;
+    }
+
+    key = 0;
+    for (int r = 0; r < PC_MAX_HEIGHT; ++r)
+        key = (key << BOARD_WIDTH) | board.rows[BOARD_HEIGHT - PC_MAX_HEIGHT + r];
+    return true;
+}
+
+uint32_t getOpeningQueueKey(const int* pieces)
+{
+    uint32_t key = 0;
+    for (int i = 0; i < OPENING_QUEUE_SIZE; ++i)
+        key |= (uint32_t)pieces[i] << (i * QUEUE_BITS_PER_PIECE);
+    return key;
+}
+
+void makeOpeningEntry(const Board& board, const int* pieces, const PerfectClearSolution& solution, bool isMirrorValid, OpeningEntry& entry)
+{
+    memset(&entry, 0, sizeof(entry));
+    getOpeningBoardKey(board, entry.boardKey);
+    entry.queueKey = getOpeningQueueKey(pieces);
+    entry.count = (uint8_t)solution.count;
+    entry.flags = isMirrorValid ? OPENING_MIRROR_VALID : 0;
+    for (int i = 0; i < solution.count && i < OPENING_QUEUE_SIZE; ++i)
+    {
+        entry.placements[i].rotation = (int8_t)solution.placements[i].rotation;
+        entry.placements[i].x = (int8_t)solution.placements[i].x;
+        entry.placements[i].y = (int8_t)solution.placements[i].y;
+    }
+}
+
+bool writeOpeningBook(const char* path, std::vector<OpeningEntry>& entries, int maxHeight)
+{
+    std::sort(entries.begin(), entries.end(), [](const OpeningEntry& a, const OpeningEntry& b)
+    {
+        return isBefore(a, b.boardKey, b.queueKey);
+    });
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+
+    OpeningHeader header = {};
+    memcpy(header.magic, OPENING_MAGIC, sizeof(OPENING_MAGIC));
+    header.version = OPENING_VERSION;
+    header.entryCount = entries.size();
+    header.queueSize = OPENING_QUEUE_SIZE;
+    header.maxHeight = (uint32_t)maxHeight;
+    header.rotationSystem = (uint8_t)getRotationSystem();
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(entries.data(), sizeof(OpeningEntry), entries.size(), file) == entries.size();
+    return fclose(file) == 0 && isWritten;
+}
+
+bool openOpeningBook(OpeningBook& book, const char* path)
+{
+    book.header = nullptr;
+    book.entries = nullptr;
+    if (!mapFile(path, book.file))
+        return false;
+
+    const OpeningHeader* header = (const OpeningHeader*)book.file.data;
+    bool isValid = book.file.size >= sizeof(OpeningHeader)
+        && memcmp(header->magic, OPENING_MAGIC, sizeof(OPENING_MAGIC)) == 0
+        && header->version == OPENING_VERSION
+        && header->queueSize == OPENING_QUEUE_SIZE
+        && header->rotationSystem == getRotationSystem()
+        && header->entryCount <= (book.file.size - sizeof(OpeningHeader)) / sizeof(OpeningEntry);
+    if (!isValid)
+    {
+        unmapFile(book.file);
+        return false;
+    }
+
+    book.header = header;
+    book.entries = (const OpeningEntry*)(book.file.data + sizeof(OpeningHeader));
+    return true;
+}
+
+void closeOpeningBook(OpeningBook& book)
+{
+    unmapFile(book.file);
+    book.header = nullptr;
+    book.entries = nullptr;
+}
+
+bool findOpening(const OpeningBook& book, const Board& board, const int* pieces, PerfectClearSolution& solution)
+{
+    solution.count = 0;
+    Board canonical;
+    int canonicalPieces[OPENING_QUEUE_SIZE];
+    bool isMirrored = canonicalizePosition(board, pieces, OPENING_QUEUE_SIZE, canonical, canonicalPieces);
+
+    uint64_t boardKey;
+    if (book.header == nullptr || !getOpeningBoardKey(canonical, boardKey))
+        return false;
+    uint32_t queueKey = getOpeningQueueKey(canonicalPieces);
+
+    // Only the probed pages are ever read from disk
+    const OpeningEntry* end = book.entries + book.header->entryCount;
+    const OpeningEntry* entry = std::lower_bound(book.entries, end, 0, [&](const OpeningEntry& candidate, int)
+    {
+        return isBefore(candidate, boardKey, queueKey);
+    });
+    if (entry == end || entry->boardKey != boardKey || entry->queueKey != queueKey)
+        return false;
+    if (isMirrored && !(entry->flags & OPENING_MIRROR_VALID))
+        return false;
+
+    solution.count = entry->count;
+    for (int i = 0; i < entry->count; ++i)
+    {
+        Tetromino& tetromino = solution.placements[i];
+        tetromino = {};
+        tetromino.type = canonicalPieces[i];
+        tetromino.rotation = entry->placements[i].rotation;
+        tetromino.x = entry->placements[i].x;
+        tetromino.y = entry->placements[i].y;
+        if (isMirrored)
+            tetromino = mirrorTetromino(tetromino);
+    }
+    return true;
+}
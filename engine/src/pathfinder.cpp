@@ -0,0 +1,153 @@
+#include "pathfinder.h"
+
+#include <cstring>
+
+const uint16_t START_MARKER = 7; // Low bits of the start state, distinct from any move + 1
+
+static_assert(MOVE_COUNT < START_MARKER, "Moves must fit in the low three bits");
+static_assert(((PATH_STATE_COUNT - 1) << 3 | START_MARKER) <= 0xFFFF, "Parent pointers must fit in 16 bits");
+
+static int getStateIndex(const Tetromino& tetromino)
+{
+    int row = tetromino.y + PATH_ROWS_ABOVE;
+    if (tetromino.x < 0 || tetromino.x >= BOARD_WIDTH || row < 0 || row >= PATH_STATE_ROWS)
+        return -1;
+    return (tetromino.rotation * PATH_STATE_ROWS + row) * BOARD_WIDTH + tetromino.x;
+}
+
+static Tetromino getStateTetromino(const Tetromino& start, int state)
+{
+    Tetromino tetromino = start;
+    tetromino.x = state % BOARD_WIDTH;
+    tetromino.y = state / BOARD_WIDTH % PATH_STATE_ROWS - PATH_ROWS_ABOVE;
+    tetromino.rotation = state / (BOARD_WIDTH * PATH_STATE_ROWS);
+    return tetromino;
+}
+
+bool applyMove(Tetromino& tetromino, Move move, const Board& board)
+{
+    switch (move)
+    {
+    case MOVE_LEFT:
+        return moveTetromino(tetromino, -1, 0, board);
+    case MOVE_RIGHT:
+        return moveTetromino(tetromino, 1, 0, board);
+    case MOVE_SOFT_DROP:
+        return moveTetromino(tetromino, 0, 1, board);
+    case MOVE_ROTATE:
+        return rotateTetromino(tetromino, board);
+    case MOVE_HARD_DROP:
+    {
+        int y = tetromino.y;
+        dropTetromino(tetromino, board);
+        return tetromino.y != y;
+    }
+    default:
+        return false;
+    }
+}
+
+bool stepGame(Game& game, uint8_t moves, int& gravityTicks)
+{
+    if (game.isGameOver)
+        return false;
+
+    bool isChanged = false;
+    for (int move = 0; move < MOVE_COUNT; ++move)
+    {
+        if ((moves & (1 << move)) && applyMove(game.current, (Move)move, game.board))
+        {
+            game.isLastMoveRotation = move == MOVE_ROTATE;
+            isChanged = true;
+        }
+    }
+
+    if (++gravityTicks >= GRAVITY_TICKS)
+    {
+        applyGravity(game);
+        gravityTicks = 0;
+        isChanged = true;
+    }
+    return isChanged;
+}
+
+void findReachable(const Board& board, const Tetromino& start, Reachability& reachability)
+{
+    reachability.start = start;
+    memset(reachability.parents, 0, sizeof(reachability.parents));
+
+    int startState = getStateIndex(start);
+    if (startState < 0 || checkCollision(start, board))
+        return;
+
+    // The start state points at itself so that it reads as reached
+    uint16_t queue[PATH_STATE_COUNT];
+    int head = 0;
+    int tail = 0;
+    reachability.parents[startState] = (uint16_t)(startState << 3 | START_MARKER);
+    queue[tail++] = (uint16_t)startState;
+
+    while (head < tail)
+    {
+        int state = queue[head++];
+        Tetromino current = getStateTetromino(start, state);
+        for (int move = 0; move < MOVE_COUNT; ++move)
+        {
+            Tetromino next = current;
+            if (!applyMove(next, (Move)move, board))
+                continue;
+
+            int nextState = getStateIndex(next);
+            if (nextState < 0 || reachability.parents[nextState] != 0)
+                continue;
+
+            reachability.parents[nextState] = (uint16_t)(state << 3 | (move + 1));
+            queue[tail++] = (uint16_t)nextState;
+        }
+    }
+}
+
+bool isReachable(const Reachability& reachability, const Tetromino& target)
+{
+    int state = getStateIndex(target);
+    return state >= 0 && target.type == reachability.start.type && reachability.parents[state] != 0;
+}
+
+int getLandedTetrominoes(const Reachability& reachability, const Board& board, Tetromino* landed)
+{
+    int count = 0;
+    for (int state = 0; state < PATH_STATE_COUNT; ++state)
+    {
+        if (reachability.parents[state] == 0)
+            continue;
+
+        Tetromino tetromino = getStateTetromino(reachability.start, state);
+        Tetromino lowered = tetromino;
+        if (!moveTetromino(lowered, 0, 1, board))
+            landed[count++] = tetromino;
+    }
+    return count;
+}
+
+int findPath(const Reachability& reachability, const Tetromino& target, Move* path)
+{
+    if (!isReachable(reachability, target))
+        return -1;
+
+    // Walk the parent pointers back to the start, then reverse into input order
+    int length = 0;
+    int state = getStateIndex(target);
+    while ((reachability.parents[state] & 7) != START_MARKER)
+    {
+        path[length++] = (Move)((reachability.parents[state] & 7) - 1);
+        state = reachability.parents[state] >> 3;
+    }
+
+    for (int i = 0; i < length / 2; ++i)
+    {
+        Move move = path[i];
+        path[i] = path[length - 1 - i];
+        path[length - 1 - i] = move;
+    }
+    return length;
+}
@@ -0,0 +1,504 @@
+#include "perfect_clear.h"
+
+#include <bit>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Rows of open space kept above the region; every piece shape fits entirely inside them
+const int TOP_MARGIN = 4;
+const int MAX_REGION_MOVES = ROTATION_COUNT * PC_MAX_HEIGHT * BOARD_WIDTH;
+const int MAX_PROBES = 64;
+
+const Row EVEN_COLUMNS = (Row)(0x5555 & FULL_ROW);
+
+static_assert(PC_MAX_HEIGHT * BOARD_WIDTH <= 60, "A region plus its height must pack into 64 bits");
+
+// Row masks of a piece relative to its pivot, leftmost block at bit 0
+struct PieceShape
+{
+    int minDx, maxDx;
+    int minDy, rowCount;
+    Row rowMasks[TETROMINO_SIZE];
+};
+
+// Bottom rows of the board that a perfect clear has to empty; rows[0] is the top one
+struct Region
+{
+    Row rows[PC_MAX_HEIGHT];
+    int height;
+};
+
+struct RegionMove
+{
+    int rotation, x, y;
+    int height; // Region height the move was made in
+    Region result;
+};
+
+struct SearchContext
+{
+    PerfectClearSolver* solver;
+    const int* pieces;
+    int pieceCount;
+    std::atomic<bool>* isSolved;
+    uint64_t nodes;
+    int length; // Pieces used by the solution once found
+    RegionMove path[PC_MAX_PIECES];
+};
+
+struct PieceShapeTable
+{
+    PieceShape shapes[PIECE_TYPE_COUNT][ROTATION_COUNT];
+};
+
+static PieceShapeTable buildPieceShapes()
+{
+    PieceShapeTable table = {};
+    for (int type = 0; type < PIECE_TYPE_COUNT; ++type)
+    {
+        for (int rotation = 0; rotation < ROTATION_COUNT; ++rotation)
+        {
+            Tetromino tetromino = {};
+            tetromino.type = type;
+            tetromino.rotation = type == PIECE_SQUARE ? 0 : rotation;
+            Block blocks[TETROMINO_SIZE];
+            getBlocks(tetromino, blocks);
+
+            PieceShape& shape = table.shapes[type][rotation];
+            shape.minDx = shape.maxDx = blocks[0].x;
+            shape.minDy = blocks[0].y;
+            int maxDy = blocks[0].y;
+            for (const Block& block : blocks)
+            {
+                shape.minDx = block.x < shape.minDx ? block.x : shape.minDx;
+                shape.maxDx = block.x > shape.maxDx ? block.x : shape.maxDx;
+                shape.minDy = block.y < shape.minDy ? block.y : shape.minDy;
+                maxDy = block.y > maxDy ? block.y : maxDy;
+            }
+            shape.rowCount = maxDy - shape.minDy + 1;
+            for (const Block& block : blocks)
+                shape.rowMasks[block.y - shape.minDy] |= (Row)(1u << (block.x - shape.minDx));
+        }
+    }
+    return table;
+}
+
+static const PieceShapeTable PIECE_SHAPES = buildPieceShapes();
+
+static uint64_t packRegion(const Region& region)
+{
+    // Bottom aligned so that a shrinking region keeps its rows in place; height in the top bits
+    uint64_t key = (uint64_t)region.height << 60;
+    for (int r = 0; r < region.height; ++r)
+        key |= (uint64_t)region.rows[r] << ((region.height - 1 - r) * BOARD_WIDTH);
+    return key;
+}
+
+static void clearRegionLines(Region& region)
+{
+    int target = region.height - 1;
+    for (int r = region.height - 1; r >= 0; --r)
+    {
+        if (region.rows[r] != FULL_ROW)
+            region.rows[target--] = region.rows[r];
+    }
+
+    // Rows above the surviving ones are empty, so the region just gets shorter
+    int cleared = target + 1;
+    for (int r = 0; r < region.height - cleared; ++r)
+        region.rows[r] = region.rows[r + cleared];
+    region.height -= cleared;
+}
+
+// Pivot columns at which the shape overlaps the row, as a mask over x
+static Row getBlockedColumns(const PieceShape& shape, int shapeRow, Row row)
+{
+    Row blocked = 0;
+    Row mask = shape.rowMasks[shapeRow];
+    while (mask)
+    {
+        int shift = shape.minDx + std::countr_zero((unsigned)mask);
+        blocked |= shift >= 0 ? (Row)(row >> shift) : (Row)(row << -shift);
+        mask &= mask - 1;
+    }
+    return blocked;
+}
+
+// Moves every column in mask dx to the right, dropping whatever leaves the row
+static Row shiftColumns(Row mask, int dx)
+{
+    return (Row)((dx >= 0 ? mask << dx : mask >> -dx) & FULL_ROW);
+}
+
+// Every distinct lock of the piece inside the region, including tucks and spins.
+// Reachability is a flood fill over per-row masks of pivot columns instead of one pose at a time.
+static int generateMoves(const Region& region, int type, RegionMove* moves)
+{
+    const PieceShape* shapes = PIECE_SHAPES.shapes[type];
+    const int rows = region.height + TOP_MARGIN;
+    const int rotations = type == PIECE_SQUARE ? 1 : ROTATION_COUNT;
+
+    // free[rotation][row]: pivot columns where the piece fits with its pivot on row - TOP_MARGIN
+    Row free[ROTATION_COUNT][PC_MAX_HEIGHT + TOP_MARGIN];
+    Row reach[ROTATION_COUNT][PC_MAX_HEIGHT + TOP_MARGIN] = {};
+    for (int rotation = 0; rotation < rotations; ++rotation)
+    {
+        const PieceShape& shape = shapes[rotation];
+        Row inside = (Row)((FULL_ROW >> (shape.maxDx - shape.minDx)) << -shape.minDx) & FULL_ROW;
+        for (int row = 0; row < rows; ++row)
+        {
+            Row blocked = 0;
+            for (int i = 0; i < shape.rowCount; ++i)
+            {
+                int regionRow = row - TOP_MARGIN + shape.minDy + i;
+                if (regionRow >= region.height)
+                    blocked = FULL_ROW;
+                else if (regionRow >= 0)
+                    blocked |= getBlockedColumns(shape, i, region.rows[regionRow]);
+            }
+            free[rotation][row] = (Row)(inside & ~blocked);
+        }
+
+        // Above the region the board is empty, so every rotation and column is reachable from spawn
+        reach[rotation][0] = free[rotation][0];
+    }
+
+    // Rotations only turn clockwise, so each rotation is entered from the one before it
+    const Kick* kicks[ROTATION_COUNT];
+    int kickCounts[ROTATION_COUNT];
+    for (int rotation = 0; rotation < rotations; ++rotation)
+        kicks[rotation] = getKicks(type, rotation, kickCounts[rotation]);
+
+    bool isChanged = true;
+    while (isChanged)
+    {
+        isChanged = false;
+        for (int rotation = 0; rotation < rotations; ++rotation)
+        {
+            // Like rotateTetromino, every pose takes the first kick that fits and no other. Poses kicked
+            // above row 0 land where the whole row is already reached, so they are only taken, not added.
+            Row kicked[PC_MAX_HEIGHT + TOP_MARGIN] = {};
+            if (rotations > 1)
+            {
+                int previousRotation = (rotation + rotations - 1) % rotations;
+                for (int row = 0; row < rows; ++row)
+                {
+                    Row remaining = reach[previousRotation][row];
+                    for (int i = 0; i < kickCounts[previousRotation] && remaining; ++i)
+                    {
+                        const Kick& kick = kicks[previousRotation][i];
+                        int target = row + kick.y;
+                        if (target >= rows)
+                            continue;
+
+                        Row targetFree = target >= 0 ? free[rotation][target] : free[rotation][0];
+                        Row taken = remaining & shiftColumns(targetFree, -kick.x);
+                        remaining &= (Row)~taken;
+                        if (target >= 0)
+                            kicked[target] |= shiftColumns(taken, kick.x);
+                    }
+                }
+            }
+
+            for (int row = 0; row < rows; ++row)
+            {
+                Row mask = reach[rotation][row] | kicked[row];
+                if (row > 0)
+                    mask |= reach[rotation][row - 1] & free[rotation][row];
+
+                Row spread;
+                while ((spread = (Row)(mask | (((mask << 1) | (mask >> 1)) & free[rotation][row]))) != mask)
+                    mask = spread;
+
+                if (mask != reach[rotation][row])
+                {
+                    reach[rotation][row] = mask;
+                    isChanged = true;
+                }
+            }
+        }
+    }
+
+    uint64_t seen[MAX_REGION_MOVES];
+    int count = 0;
+    for (int rotation = 0; rotation < rotations; ++rotation)
+    {
+        const PieceShape& shape = shapes[rotation];
+        for (int row = TOP_MARGIN - shape.minDy; row < rows; ++row)
+        {
+            // Blocked below, with no block left in the open space above the region
+            Row landed = reach[rotation][row] & (Row)~(row + 1 < rows ? free[rotation][row + 1] : 0);
+            while (landed)
+            {
+                int x = std::countr_zero((unsigned)landed);
+                landed &= landed - 1;
+
+                int y = row - TOP_MARGIN;
+                RegionMove& move = moves[count];
+                move.rotation = rotation;
+                move.x = x;
+                move.y = y;
+                move.height = region.height;
+                move.result = region;
+                for (int i = 0; i < shape.rowCount; ++i)
+                    move.result.rows[y + shape.minDy + i] |= (Row)(shape.rowMasks[i] << (x + shape.minDx));
+
+                uint64_t key = packRegion(move.result);
+                bool isDuplicate = false;
+                for (int i = 0; i < count && !isDuplicate; ++i)
+                    isDuplicate = seen[i] == key;
+                if (isDuplicate)
+                    continue;
+
+                seen[count] = key;
+                clearRegionLines(move.result);
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+// Cell count and column parity: the empty cells left must be exactly what the next pieces can fill
+static bool canStillClear(const Region& region, const int* pieces, int pieceIndex, int pieceCount)
+{
+    int evenEmpty = 0;
+    int oddEmpty = 0;
+    for (int r = 0; r < region.height; ++r)
+    {
+        Row empty = (Row)(~region.rows[r] & FULL_ROW);
+        evenEmpty += std::popcount((unsigned)(empty & EVEN_COLUMNS));
+        oddEmpty += std::popcount((unsigned)(empty & ~EVEN_COLUMNS & FULL_ROW));
+    }
+
+    int emptyCells = evenEmpty + oddEmpty;
+    if (emptyCells % TETROMINO_SIZE != 0)
+        return false;
+
+    // If every row has a block on one side of the seam between columns x and x + 1, no piece can
+    // ever straddle it (clears remove whole rows), so the empty cells left of it need whole pieces
+    Row walls = FULL_ROW;
+    for (int r = 0; r < region.height; ++r)
+        walls &= (Row)(region.rows[r] | (region.rows[r] >> 1));
+    walls &= (Row)(FULL_ROW >> 1);
+    while (walls)
+    {
+        int x = std::countr_zero((unsigned)walls);
+        Row left = (Row)((2u << x) - 1);
+        int leftEmpty = 0;
+        for (int r = 0; r < region.height; ++r)
+            leftEmpty += std::popcount((unsigned)(~region.rows[r] & left));
+        if (leftEmpty % TETROMINO_SIZE != 0)
+            return false;
+        walls &= walls - 1;
+    }
+    int needed = emptyCells / TETROMINO_SIZE;
+    if (pieceIndex + needed > pieceCount)
+        return false;
+
+    // L-shapes always cover three columns of one parity, T-shapes do when upright and lines cover four when upright
+    int lShapes = 0;
+    int tShapes = 0;
+    int lines = 0;
+    for (int i = pieceIndex; i < pieceIndex + needed; ++i)
+    {
+        lShapes += pieces[i] == PIECE_L || pieces[i] == PIECE_REVERSE_L;
+        tShapes += pieces[i] == PIECE_T;
+        lines += pieces[i] == PIECE_LINE;
+    }
+
+    int imbalance = evenEmpty > oddEmpty ? evenEmpty - oddEmpty : oddEmpty - evenEmpty;
+    if (imbalance > 2 * (lShapes + tShapes) + 4 * lines)
+        return false;
+    if (tShapes == 0 && (imbalance - 2 * lShapes) % 4 != 0)
+        return false;
+    return true;
+}
+
+// Try moves that clear lines or settle lowest first: they reach full rows sooner
+static void sortMoves(const RegionMove* moves, int count, int* order)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int key = moves[i].result.height - moves[i].height - moves[i].y;
+        int j = i;
+        while (j > 0 && moves[order[j - 1]].result.height - moves[order[j - 1]].height - moves[order[j - 1]].y > key)
+        {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = i;
+    }
+}
+
+static uint64_t hashKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+static bool hasFailed(const PerfectClearSolver& solver, uint64_t key)
+{
+    uint64_t slot = hashKey(key);
+    for (int probe = 0; probe < MAX_PROBES; ++probe, ++slot)
+    {
+        uint64_t stored = solver.failedStates[slot & (PC_FAILED_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (stored == key)
+            return true;
+        if (stored == 0)
+            return false;
+    }
+    return false;
+}
+
+static void markFailed(PerfectClearSolver& solver, uint64_t key)
+{
+    uint64_t slot = hashKey(key);
+    for (int probe = 0; probe < MAX_PROBES; ++probe, ++slot)
+    {
+        std::atomic<uint64_t>& entry = solver.failedStates[slot & (PC_FAILED_CAPACITY - 1)];
+        uint64_t stored = entry.load(std::memory_order_relaxed);
+        if (stored == 0 && entry.compare_exchange_strong(stored, key, std::memory_order_relaxed))
+            return;
+        if (stored == key)
+            return;
+    }
+    // Neighbourhood full: forgetting a failure only costs time
+}
+
+static bool search(SearchContext& context, const Region& region, int pieceIndex)
+{
+    if (region.height == 0)
+    {
+        context.length = pieceIndex;
+        return true;
+    }
+    if (context.isSolved->load(std::memory_order_relaxed))
+        return false;
+
+    ++context.nodes;
+    if (!canStillClear(region, context.pieces, pieceIndex, context.pieceCount))
+        return false;
+
+    // The key is exact: the root plus the region and its height determine how many pieces were used
+    uint64_t key = packRegion(region);
+    if (hasFailed(*context.solver, key))
+        return false;
+
+    RegionMove moves[MAX_REGION_MOVES];
+    int count = generateMoves(region, context.pieces[pieceIndex], moves);
+    int order[MAX_REGION_MOVES];
+    sortMoves(moves, count, order);
+    for (int i = 0; i < count; ++i)
+    {
+        const RegionMove& move = moves[order[i]];
+        context.path[pieceIndex] = move;
+        if (search(context, move.result, pieceIndex + 1))
+            return true;
+    }
+
+    // An aborted search proves nothing
+    if (!context.isSolved->load(std::memory_order_relaxed))
+        markFailed(*context.solver, key);
+    return false;
+}
+
+static void writeSolution(const SearchContext& context, int length, PerfectClearSolution& solution)
+{
+    solution.count = length;
+    for (int i = 0; i < length; ++i)
+    {
+        const RegionMove& move = context.path[i];
+        Tetromino& tetromino = solution.placements[i];
+        tetromino = {};
+        tetromino.type = context.pieces[i];
+        tetromino.rotation = move.rotation;
+        tetromino.x = move.x;
+        tetromino.y = BOARD_HEIGHT - move.height + move.y;
+    }
+}
+
+bool solvePerfectClear(PerfectClearSolver& solver, const Board& board, const int* pieces, int pieceCount, int maxHeight, int threadCount, PerfectClearSolution& solution)
+{
+    solution.count = 0;
+    if (pieceCount > PC_MAX_PIECES)
+        pieceCount = PC_MAX_PIECES;
+    if (maxHeight > PC_MAX_HEIGHT)
+        maxHeight = PC_MAX_HEIGHT;
+    if (threadCount < 1)
+        threadCount = 1;
+    if (!solver.failedStates)
+        solver.failedStates.reset(new std::atomic<uint64_t>[PC_FAILED_CAPACITY]);
+    solver.nodes = 0;
+
+    int stackHeight = 0;
+    while (stackHeight < BOARD_HEIGHT && board.rows[BOARD_HEIGHT - 1 - stackHeight] != 0)
+        ++stackHeight;
+    for (int y = 0; y < BOARD_HEIGHT - stackHeight; ++y)
+    {
+        if (board.rows[y] != 0)
+            return false; // Floating cells above an empty row can never be cleared together
+    }
+
+    for (int height = stackHeight > 0 ? stackHeight : 1; height <= maxHeight; ++height)
+    {
+        Region region;
+        region.height = height;
+        for (int r = 0; r < height; ++r)
+            region.rows[r] = board.rows[BOARD_HEIGHT - height + r];
+        if (!canStillClear(region, pieces, 0, pieceCount))
+            continue;
+
+        for (int i = 0; i < PC_FAILED_CAPACITY; ++i)
+            solver.failedStates[i].store(0, std::memory_order_relaxed);
+
+        RegionMove rootMoves[MAX_REGION_MOVES];
+        int rootCount = generateMoves(region, pieces[0], rootMoves);
+
+        // Workers take first moves from a shared counter; the first to finish a clear stops the rest
+        std::atomic<int> nextRoot(0);
+        std::atomic<bool> isSolved(false);
+        std::atomic<bool> isWritten(false);
+        auto work = [&]()
+        {
+            SearchContext context;
+            context.solver = &solver;
+            context.pieces = pieces;
+            context.pieceCount = pieceCount;
+            context.isSolved = &isSolved;
+            context.nodes = 0;
+            context.length = 0;
+
+            int root;
+            while (!isSolved.load(std::memory_order_relaxed) && (root = nextRoot.fetch_add(1)) < rootCount)
+            {
+                context.path[0] = rootMoves[root];
+                if (search(context, rootMoves[root].result, 1))
+                {
+                    bool expected = false;
+                    if (isWritten.compare_exchange_strong(expected, true))
+                        writeSolution(context, context.length, solution);
+                    isSolved = true;
+                }
+            }
+            solver.nodes += context.nodes;
+        };
+
+        int workers = threadCount < rootCount ? threadCount : rootCount;
+        std::vector<std::thread> threads;
+        for (int t = 1; t < workers; ++t)
+            threads.emplace_back(work);
+        work();
+        for (std::thread& thread : threads)
+            thread.join();
+
+        if (isWritten)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,74 @@
+#include "perft.h"
+#include "pathfinder.h"
+
+#include <cstring>
+#include <vector>
+
+// Working space for one level of the search. The arrays come to about 150 KB, too much to put
+// on the stack once per level, so they are allocated once per call for every depth.
+struct PerftScratch
+{
+    Reachability reachability;
+    Tetromino candidates[PATH_STATE_COUNT];
+    Tetromino landed[PATH_STATE_COUNT];
+    Board locked[PATH_STATE_COUNT];
+};
+
+// Locks every reachable landing into its own board and drops the ones that repeat, leaving the
+// distinct landings in scratch.landed
+static int getDistinctLocks(const Game& game, PerftScratch& scratch)
+{
+    findReachable(game.board, game.current, scratch.reachability);
+    int candidateCount = getLandedTetrominoes(scratch.reachability, game.board, scratch.candidates);
+
+    const Tetromino* candidates = scratch.candidates;
+    Tetromino* landed = scratch.landed;
+    Board* locked = scratch.locked;
+
+    int count = 0;
+    for (int i = 0; i < candidateCount; ++i)
+    {
+        locked[count] = game.board;
+        placeTetromino(candidates[i], locked[count]);
+
+        bool isDuplicate = false;
+        for (int j = 0; j < count && !isDuplicate; ++j)
+            isDuplicate = memcmp(locked[j].rows, locked[count].rows, sizeof(Board::rows)) == 0;
+        if (!isDuplicate)
+            landed[count++] = candidates[i];
+    }
+    return count;
+}
+
+// scratch[depth - 1] belongs to this level, the ones below it to the children
+static uint64_t countNodes(const Game& game, int depth, PerftScratch* scratch)
+{
+    if (depth == 0)
+        return 1;
+    if (game.isGameOver)
+        return 0;
+
+    PerftScratch& level = scratch[depth - 1];
+    int count = getDistinctLocks(game, level);
+    if (depth == 1)
+        return count;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        Game child = game;
+        child.current = level.landed[i];
+        lockTetromino(child);
+        nodes += countNodes(child, depth - 1, scratch);
+    }
+    return nodes;
+}
+
+uint64_t perft(const Game& game, int depth)
+{
+    if (depth <= 0)
+        return 1;
+
+    std::vector<PerftScratch> scratch(depth);
+    return countNodes(game, depth, scratch.data());
+}
@@ -0,0 +1,169 @@
+#include "planner.h"
+
+static void pushFrame(Planner& planner, const Game& game)
+{
+    PlannerFrame& frame = planner.frames[planner.frameCount++];
+    frame.game = game;
+    frame.count = 0;
+    frame.next = 0;
+    frame.best = PLANNER_LOSS;
+    frame.isExpanded = false;
+}
+
+// The root keeps its candidates between iterations; only the previous best move moves to the front
+static void startIteration(Planner& planner)
+{
+    PlannerFrame& root = planner.frames[0];
+    planner.frameCount = 1;
+    root.next = 0;
+    root.best = PLANNER_LOSS;
+    for (int i = 1; i < root.count; ++i)
+    {
+        if (root.candidates[i].placement.rotation == planner.bestPlacement.rotation && root.candidates[i].placement.x == planner.bestPlacement.x)
+        {
+            Candidate first = root.candidates[0];
+            root.candidates[0] = root.candidates[i];
+            root.candidates[i] = first;
+            break;
+        }
+    }
+}
+
+// Ranks a first move once its subtree has a value. The previous best move is searched first, so
+// as soon as it is scored this iteration's answer is at least as informed as the last one.
+static void scoreRootMove(Planner& planner, const Candidate& candidate, bool isFirst, float value)
+{
+    if (!isFirst && value <= planner.bestScore)
+        return;
+
+    planner.bestPlacement = candidate.placement;
+    planner.bestScore = value;
+    planner.bestDepth = planner.depth;
+    planner.hasBest = true;
+}
+
+// Hands a finished frame's value to its parent
+static void popFrame(Planner& planner, float value)
+{
+    --planner.frameCount;
+    if (planner.frameCount == 0)
+        return;
+
+    PlannerFrame& parent = planner.frames[planner.frameCount - 1];
+    if (value > parent.best)
+        parent.best = value;
+    if (planner.frameCount == 1)
+        scoreRootMove(planner, parent.candidates[parent.next - 1], parent.next == 1, value);
+}
+
+static void expandFrame(Planner& planner, PlannerFrame& frame)
+{
+    frame.count = enumerateCandidates(frame.game, frame.candidates);
+    frame.isExpanded = true;
+    planner.nodes += frame.count;
+    planner.frameNodes += frame.count;
+}
+
+// One bounded unit of work: expand a frame, score a leaf ply, or descend into the next child
+static void stepPlanner(Planner& planner)
+{
+    PlannerFrame& frame = planner.frames[planner.frameCount - 1];
+    if (!frame.isExpanded)
+    {
+        expandFrame(planner, frame);
+        if (frame.count == 0)
+        {
+            popFrame(planner, PLANNER_LOSS);
+            return;
+        }
+
+        // Last ply of this iteration: let the evaluator score the whole batch at once
+        if (planner.frameCount == planner.depth)
+        {
+            float scores[MAX_CANDIDATES];
+            planner.evaluator->evaluate(frame.candidates, frame.count, scores);
+            if (planner.frameCount == 1)
+            {
+                // A one ply search ranks first moves directly
+                for (int i = 0; i < frame.count; ++i)
+                    scoreRootMove(planner, frame.candidates[i], i == 0, scores[i]);
+                planner.frameCount = 0;
+                return;
+            }
+
+            float best = scores[0];
+            for (int i = 1; i < frame.count; ++i)
+                best = scores[i] > best ? scores[i] : best;
+            popFrame(planner, best);
+        }
+        return;
+    }
+
+    if (frame.next == frame.count)
+    {
+        popFrame(planner, frame.best);
+        return;
+    }
+
+    const Candidate& candidate = frame.candidates[frame.next++];
+    Game child = frame.game;
+    child.current = candidate.tetromino;
+    lockTetromino(child);
+    pushFrame(planner, child);
+}
+
+void startPlanner(Planner& planner, const Game& game, Evaluator& evaluator, int maxDepth)
+{
+    planner.evaluator = &evaluator;
+    planner.root = game;
+    planner.maxDepth = maxDepth < 1 ? 1 : maxDepth > PLANNER_MAX_DEPTH ? PLANNER_MAX_DEPTH : maxDepth;
+    planner.depth = 1;
+    planner.bestPlacement = { 0, 0 };
+    planner.bestScore = PLANNER_LOSS;
+    planner.bestDepth = 0;
+    planner.hasBest = false;
+    planner.nodes = 0;
+    planner.frameNodes = 0;
+    planner.stepMicroseconds = 0.0f;
+    planner.isDone = game.isGameOver;
+    planner.frameCount = 0;
+    pushFrame(planner, game);
+}
+
+bool runPlanner(Planner& planner, const PlannerBudget& budget)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = now + std::chrono::microseconds(budget.microseconds);
+    planner.frameNodes = 0;
+
+    while (!planner.isDone)
+    {
+        if (budget.nodes != 0 && planner.nodes >= budget.nodes)
+        {
+            planner.isDone = true;
+            break;
+        }
+
+        // Stop early rather than start a step that would run past the deadline
+        if (budget.microseconds != 0 && now + std::chrono::microseconds((int)planner.stepMicroseconds) >= deadline)
+            break;
+
+        stepPlanner(planner);
+        auto end = std::chrono::steady_clock::now();
+        float step = std::chrono::duration<float, std::micro>(end - now).count();
+        planner.stepMicroseconds = step > planner.stepMicroseconds ? step : planner.stepMicroseconds * 0.99f + step * 0.01f;
+        now = end;
+        if (planner.frameCount == 0)
+        {
+            // Iteration finished; go one ply deeper or stop
+            if (planner.depth == planner.maxDepth)
+                planner.isDone = true;
+            else
+            {
+                ++planner.depth;
+                startIteration(planner);
+            }
+        }
+    }
+    return planner.isDone;
+}
@@ -0,0 +1,82 @@
+#include "replay.h"
+#include "mapped_file.h"
+
+#include <cstring>
+
+static_assert(sizeof(ReplayHeader) == 24, "ReplayHeader is written to disk as is");
+static_assert(sizeof(ReplayTick) == 16, "ReplayTick is written to disk as is");
+
+bool openReplayWriter(ReplayWriter& writer, const char* path, uint64_t seed)
+{
+    writer.file = fopen(path, "wb");
+    if (writer.file == nullptr)
+        return false;
+
+    writer.header = {};
+    memcpy(writer.header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    writer.header.version = REPLAY_VERSION;
+    writer.header.playerCount = ROLLBACK_PLAYERS;
+    writer.header.rotationSystem = (uint8_t)getRotationSystem();
+    writer.header.seed = seed;
+    return fwrite(&writer.header, sizeof(writer.header), 1, writer.file) == 1;
+}
+
+void recordReplay(ReplayWriter& writer, const RollbackSession& session)
+{
+    uint32_t confirmedTicks = getConfirmedTicks(session);
+    Match match;
+    while (writer.header.tickCount < confirmedTicks && getMatchAt(session, writer.header.tickCount + 1, match))
+    {
+        ReplayTick tick = {};
+        memcpy(tick.moves, session.inputs[writer.header.tickCount % ROLLBACK_WINDOW], sizeof(tick.moves));
+        tick.checksum = match.checksum;
+        fwrite(&tick, sizeof(tick), 1, writer.file);
+        ++writer.header.tickCount;
+    }
+}
+
+bool closeReplayWriter(ReplayWriter& writer)
+{
+    bool isOk = fseek(writer.file, 0, SEEK_SET) == 0 && fwrite(&writer.header, sizeof(writer.header), 1, writer.file) == 1;
+    isOk = fclose(writer.file) == 0 && isOk;
+    writer.file = nullptr;
+    return isOk;
+}
+
+bool playReplay(const char* path, ReplayResult& result)
+{
+    MappedFile file;
+    if (!mapFile(path, file))
+        return false;
+
+    const ReplayHeader* header = (const ReplayHeader*)file.data;
+    if (file.size < sizeof(ReplayHeader) || memcmp(header->magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0
+        || header->version != REPLAY_VERSION || header->playerCount != ROLLBACK_PLAYERS || header->rotationSystem >= ROTATION_SYSTEM_COUNT
+        || file.size < sizeof(ReplayHeader) + (size_t)header->tickCount * sizeof(ReplayTick))
+    {
+        unmapFile(file);
+        return false;
+    }
+
+    setRotationSystem((RotationSystem)header->rotationSystem);
+    Match& match = result.diverged;
+    resetMatch(match, header->seed);
+
+    const ReplayTick* ticks = (const ReplayTick*)(file.data + sizeof(ReplayHeader));
+    result.tickCount = header->tickCount;
+    result.desyncTick = NO_ROLLBACK;
+    for (uint32_t t = 0; t < header->tickCount; ++t)
+    {
+        result.agreed = match;
+        stepMatch(match, ticks[t].moves);
+
+        if (match.checksum != ticks[t].checksum)
+        {
+            result.desyncTick = t;
+            result.recordedChecksum = ticks[t].checksum;
+            break;
+        }
+    }
+    unmapFile(file);
+    return true;
+}
@@ -0,0 +1,168 @@
+#include "replication.h"
+
+const int QUEUE_BITS_PER_PIECE = 3;
+const int POSITION_BIAS = 4; // Pivots can sit a few cells outside the board
+
+static uint64_t packQueue(const Game& game)
+{
+    uint64_t queue = 0;
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        queue |= (uint64_t)game.queue[i] << (i * QUEUE_BITS_PER_PIECE);
+    return queue;
+}
+
+void resetReplicationEncoder(ReplicationEncoder& encoder)
+{
+    encoder.previousTick = 0;
+    encoder.frame = 0;
+    encoder.framesSinceKeyframe = 0;
+    encoder.isKeyframeRequested = true;
+}
+
+int encodeReplicationFrame(ReplicationEncoder& encoder, const Game& game, uint32_t tick, uint8_t* bytes)
+{
+    bool isKeyframe = encoder.isKeyframeRequested || encoder.framesSinceKeyframe >= REPLICATION_KEYFRAME_INTERVAL;
+    Game empty = {};
+    const Game& previous = isKeyframe ? empty : encoder.previous;
+
+    uint8_t flags = isKeyframe ? REPLICATION_KEYFRAME : 0;
+    const Tetromino& piece = game.current;
+    if (isKeyframe || piece.type != previous.current.type || piece.rotation != previous.current.rotation
+        || piece.x != previous.current.x || piece.y != previous.current.y)
+        flags |= REPLICATION_PIECE;
+    uint64_t queue = packQueue(game);
+    if (isKeyframe || queue != packQueue(previous))
+        flags |= REPLICATION_QUEUE;
+    if (isKeyframe || game.linesCleared != previous.linesCleared)
+        flags |= REPLICATION_LINES;
+    if (game.isGameOver)
+        flags |= REPLICATION_GAME_OVER;
+
+    uint8_t* payload = bytes + NET_REPLICATION_HEADER_SIZE;
+    int size = 0;
+    payload[size++] = flags;
+    size += writeVarint(payload + size, encoder.frame);
+    size += writeVarint(payload + size, isKeyframe ? tick : tick - encoder.previousTick);
+
+    // Bit y marks a row that differs from the previous frame; its xor follows
+    uint64_t changedRows = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (game.board.rows[y] != previous.board.rows[y])
+            changedRows |= 1ull << y;
+    }
+    size += writeVarint(payload + size, changedRows);
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (changedRows & (1ull << y))
+            size += writeVarint(payload + size, game.board.rows[y] ^ previous.board.rows[y]);
+    }
+
+    if (flags & REPLICATION_PIECE)
+    {
+        payload[size++] = (uint8_t)(piece.type << 2 | piece.rotation);
+        payload[size++] = (uint8_t)(piece.x + POSITION_BIAS);
+        payload[size++] = (uint8_t)(piece.y + POSITION_BIAS);
+    }
+    if (flags & REPLICATION_QUEUE)
+        size += writeVarint(payload + size, queue);
+    if (flags & REPLICATION_LINES)
+        size += writeVarint(payload + size, (uint64_t)game.linesCleared);
+
+    bytes[0] = NET_REPLICATION;
+    writeU16(bytes + 1, (uint16_t)size);
+
+    encoder.previous = game;
+    encoder.previousTick = tick;
+    ++encoder.frame;
+    encoder.framesSinceKeyframe = isKeyframe ? 1 : encoder.framesSinceKeyframe + 1;
+    encoder.isKeyframeRequested = false;
+    return NET_REPLICATION_HEADER_SIZE + size;
+}
+
+void resetReplicationDecoder(ReplicationDecoder& decoder)
+{
+    decoder.game = {};
+    decoder.tick = 0;
+    decoder.frame = 0;
+    decoder.hasKeyframe = false;
+}
+
+bool decodeReplicationFrame(ReplicationDecoder& decoder, const uint8_t* bytes, int size)
+{
+    if (size < NET_REPLICATION_HEADER_SIZE + 1 || bytes[0] != NET_REPLICATION || readU16(bytes + 1) != size - NET_REPLICATION_HEADER_SIZE)
+        return false;
+
+    const uint8_t* payload = bytes + NET_REPLICATION_HEADER_SIZE;
+    size_t available = size - NET_REPLICATION_HEADER_SIZE;
+    size_t offset = 0;
+    uint8_t flags = payload[offset++];
+    bool isKeyframe = (flags & REPLICATION_KEYFRAME) != 0;
+
+    uint64_t frame, tick, changedRows;
+    int read;
+    if (!(read = readVarint(payload + offset, available - offset, frame)))
+        return false;
+    offset += read;
+
+    // A delta only applies on top of the frame right before it
+    if (!isKeyframe && (!decoder.hasKeyframe || (uint32_t)frame != decoder.frame + 1))
+    {
+        decoder.hasKeyframe = false;
+        return false;
+    }
+
+    // Decode into a copy so a truncated frame leaves the last good state alone
+    Game game = isKeyframe ? Game{} : decoder.game;
+    if (!(read = readVarint(payload + offset, available - offset, tick)))
+        return false;
+    offset += read;
+    if (!(read = readVarint(payload + offset, available - offset, changedRows)))
+        return false;
+    offset += read;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (!(changedRows & (1ull << y)))
+            continue;
+        uint64_t change;
+        if (!(read = readVarint(payload + offset, available - offset, change)))
+            return false;
+        offset += read;
+        game.board.rows[y] ^= (Row)change;
+    }
+
+    if (flags & REPLICATION_PIECE)
+    {
+        if (available - offset < 3)
+            return false;
+        game.current.type = payload[offset] >> 2;
+        game.current.rotation = payload[offset] & 3;
+        game.current.x = payload[offset + 1] - POSITION_BIAS;
+        game.current.y = payload[offset + 2] - POSITION_BIAS;
+        offset += 3;
+    }
+    if (flags & REPLICATION_QUEUE)
+    {
+        uint64_t queue;
+        if (!(read = readVarint(payload + offset, available - offset, queue)))
+            return false;
+        offset += read;
+        for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+            game.queue[i] = (int)((queue >> (i * QUEUE_BITS_PER_PIECE)) & 7);
+    }
+    if (flags & REPLICATION_LINES)
+    {
+        uint64_t lines;
+        if (!(read = readVarint(payload + offset, available - offset, lines)))
+            return false;
+        offset += read;
+        game.linesCleared = (int)lines;
+    }
+    game.isGameOver = (flags & REPLICATION_GAME_OVER) != 0;
+
+    decoder.game = game;
+    decoder.tick = isKeyframe ? (uint32_t)tick : decoder.tick + (uint32_t)tick;
+    decoder.frame = (uint32_t)frame;
+    decoder.hasKeyframe = true;
+    return true;
+}
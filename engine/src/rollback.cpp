@@ -0,0 +1,172 @@
+#include "rollback.h"
+#include "checksum.h"
+#include "pathfinder.h"
+
+#include <chrono>
+#include <cstring>
+
+void resetMatch(Match& match, uint64_t seed)
+{
+    memset(&match, 0, sizeof(match));
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+        resetGame(match.players[player], seed);
+    resetVersusGarbage(match.garbage, seed);
+}
+
+void stepMatch(Match& match, const uint8_t moves[ROLLBACK_PLAYERS])
+{
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        Game& game = match.players[player];
+        int piecesPlaced = game.piecesPlaced;
+        int linesCleared = game.linesCleared;
+        stepGame(game, moves[player], match.gravityTicks[player]);
+        if (game.piecesPlaced != piecesPlaced)
+            resolveLock(match.garbage, match.players, player, game.linesCleared - linesCleared);
+    }
+
+    // Garbage can change either board, so both are folded in once the tick is settled, and what is
+    // still queued along with them
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+        match.checksum = rollChecksum(match.checksum, match.players[player]);
+    match.checksum = rollChecksum(match.checksum, match.garbage);
+    ++match.tick;
+}
+
+static void simulateTick(RollbackSession& session)
+{
+    int slot = session.match.tick % ROLLBACK_WINDOW;
+    session.snapshots[slot] = session.match;
+    stepMatch(session.match, session.inputs[slot]);
+}
+
+void startRollback(RollbackSession& session, uint64_t seed, int localPlayer)
+{
+    resetMatch(session.match, seed);
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+        session.confirmedTicks[player] = 0;
+    memset(session.inputs, 0, sizeof(session.inputs));
+    session.rollbackTick = NO_ROLLBACK;
+    session.localPlayer = localPlayer;
+    session.stats = {};
+}
+
+bool addRemoteInput(RollbackSession& session, int player, uint32_t tick, uint8_t moves)
+{
+    if (player == session.localPlayer || tick != session.confirmedTicks[player] || tick > session.match.tick)
+        return false;
+
+    // The input slot of a tick is shared with the tick a window earlier; while a rollback to that one is
+    // pending, its input is still needed to simulate it again
+    if (session.rollbackTick != NO_ROLLBACK && tick - session.rollbackTick >= ROLLBACK_WINDOW)
+        return false;
+
+    // A tick already simulated was a guess; if the guess was wrong everything after it is too
+    uint8_t& input = session.inputs[tick % ROLLBACK_WINDOW][player];
+    if (tick < session.match.tick && input != moves && tick < session.rollbackTick)
+        session.rollbackTick = tick;
+    input = moves;
+    session.confirmedTicks[player] = tick + 1;
+    return true;
+}
+
+bool advanceRollback(RollbackSession& session, uint8_t localMoves)
+{
+    Match& match = session.match;
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        // The remote input for this very tick may already be in, so confirmedTicks can be ahead of match.tick
+        if (player != session.localPlayer && session.confirmedTicks[player] + ROLLBACK_WINDOW <= match.tick)
+        {
+            ++session.stats.stalls;
+            return false;
+        }
+    }
+
+    RollbackStats& stats = session.stats;
+    if (session.rollbackTick != NO_ROLLBACK)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint32_t target = match.tick;
+        match = session.snapshots[session.rollbackTick % ROLLBACK_WINDOW];
+        while (match.tick < target)
+            simulateTick(session);
+
+        int depth = (int)(target - session.rollbackTick);
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        ++stats.rollbacks;
+        stats.resimulatedTicks += depth;
+        stats.lastDepth = depth;
+        stats.lastMicroseconds = microseconds;
+        stats.totalMicroseconds += microseconds;
+        if (depth > stats.maxDepth)
+            stats.maxDepth = depth;
+        if (microseconds > stats.maxMicroseconds)
+            stats.maxMicroseconds = microseconds;
+        session.rollbackTick = NO_ROLLBACK;
+    }
+
+    // Moves are presses rather than held buttons, so the best guess for a missing input is no input;
+    // repeating the last one would replay a shift or a rotation
+    int slot = match.tick % ROLLBACK_WINDOW;
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        if (player == session.localPlayer)
+            session.inputs[slot][player] = localMoves;
+        else if (match.tick >= session.confirmedTicks[player])
+            session.inputs[slot][player] = 0;
+    }
+    simulateTick(session);
+    ++stats.ticks;
+    return true;
+}
+
+uint32_t getConfirmedTicks(const RollbackSession& session)
+{
+    uint32_t ticks = session.match.tick;
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        if (player != session.localPlayer && session.confirmedTicks[player] < ticks)
+            ticks = session.confirmedTicks[player];
+    }
+
+    // A pending rollback means the ticks after it are about to change
+    return session.rollbackTick < ticks ? session.rollbackTick : ticks;
+}
+
+bool getMatchAt(const RollbackSession& session, uint32_t ticks, Match& match)
+{
+    if (ticks == session.match.tick)
+        match = session.match;
+    else if (ticks < session.match.tick && session.match.tick - ticks <= ROLLBACK_WINDOW)
+        match = session.snapshots[ticks % ROLLBACK_WINDOW];
+    else
+        return false;
+
+    // The snapshot slot may already hold a later tick after a stall
+    return match.tick == ticks;
+}
+
+bool checkRemoteChecksum(RollbackSession& session, uint32_t ticks, uint64_t checksum)
+{
+    Match match;
+    if (ticks > getConfirmedTicks(session) || !getMatchAt(session, ticks, match))
+        return true;
+
+    ++session.stats.checksumsCompared;
+    if (match.checksum == checksum)
+        return true;
+    ++session.stats.desyncs;
+    return false;
+}
+
+void dumpMatch(FILE* file, const Match& match)
+{
+    fprintf(file, "tick %u, checksum %016llx\n", match.tick, (unsigned long long)match.checksum);
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        fprintf(file, "player %d, gravity %d/%d, %d garbage lines pending, %u sent\n", player, match.gravityTicks[player], GRAVITY_TICKS,
+            match.garbage.queues[player].pending, match.garbage.linesSent[player]);
+        dumpGame(file, match.players[player]);
+    }
+}
@@ -0,0 +1,295 @@
+#include "sandbox.h"
+
+#include <bit>
+#include <cstring>
+
+const int CHUNK_MASK = SANDBOX_CHUNK_SIZE - 1;
+
+static uint32_t allocateChunk(SandboxBoard& board, int chunkX, int chunkY)
+{
+    uint32_t index;
+    if (!board.freeChunks.empty())
+    {
+        index = board.freeChunks.back();
+        board.freeChunks.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)board.chunks.size();
+        board.chunks.emplace_back();
+    }
+
+    SandboxChunk& chunk = board.chunks[index];
+    memset(chunk.rows, 0, sizeof(chunk.rows));
+    chunk.cellCount = 0;
+    chunk.chunkX = chunkX;
+    chunk.chunkY = chunkY;
+    chunk.occupiedSlot = (int)board.occupied.size();
+    board.occupied.push_back(index);
+    board.grid[(size_t)chunkY * board.chunkColumns + chunkX] = index;
+    return index;
+}
+
+// Hands an emptied chunk back and points its position at the shared empty chunk again
+static void releaseChunk(SandboxBoard& board, uint32_t index)
+{
+    SandboxChunk& chunk = board.chunks[index];
+    board.grid[(size_t)chunk.chunkY * board.chunkColumns + chunk.chunkX] = SANDBOX_EMPTY_CHUNK;
+
+    uint32_t last = board.occupied.back();
+    board.occupied[chunk.occupiedSlot] = last;
+    board.chunks[last].occupiedSlot = chunk.occupiedSlot;
+    board.occupied.pop_back();
+    board.freeChunks.push_back(index);
+}
+
+// Whether no chunk overlapping the cells x0..x1, y0..y1 holds anything
+static bool isSandboxAreaEmpty(const SandboxBoard& board, int x0, int x1, int y0, int y1)
+{
+    for (int chunkY = y0 >> SANDBOX_CHUNK_SHIFT; chunkY <= y1 >> SANDBOX_CHUNK_SHIFT; ++chunkY)
+    {
+        for (int chunkX = x0 >> SANDBOX_CHUNK_SHIFT; chunkX <= x1 >> SANDBOX_CHUNK_SHIFT; ++chunkX)
+        {
+            if (board.grid[(size_t)chunkY * board.chunkColumns + chunkX] != SANDBOX_EMPTY_CHUNK)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool createSandboxBoard(SandboxBoard& board, int width, int height)
+{
+    if (width < TETROMINO_SIZE || height < TETROMINO_SIZE || width > SANDBOX_MAX_SIZE || height > SANDBOX_MAX_SIZE)
+        return false;
+
+    board.width = width;
+    board.height = height;
+    board.chunkColumns = (width + CHUNK_MASK) >> SANDBOX_CHUNK_SHIFT;
+    board.chunkRows = (height + CHUNK_MASK) >> SANDBOX_CHUNK_SHIFT;
+    board.grid.assign((size_t)board.chunkColumns * board.chunkRows, SANDBOX_EMPTY_CHUNK);
+    board.chunks.assign(1, SandboxChunk{});
+    board.freeChunks.clear();
+    board.occupied.clear();
+    return true;
+}
+
+bool isSandboxOccupied(const SandboxBoard& board, int x, int y)
+{
+    const SandboxChunk& chunk = getSandboxChunk(board, x >> SANDBOX_CHUNK_SHIFT, y >> SANDBOX_CHUNK_SHIFT);
+    return (chunk.rows[y & CHUNK_MASK] >> (x & CHUNK_MASK)) & 1;
+}
+
+size_t getSandboxMemory(const SandboxBoard& board)
+{
+    return board.grid.capacity() * sizeof(uint32_t) + board.chunks.capacity() * sizeof(SandboxChunk)
+        + (board.freeChunks.capacity() + board.occupied.capacity()) * sizeof(uint32_t);
+}
+
+bool checkSandboxCollision(const Tetromino& tetromino, const SandboxBoard& board)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (const Block& block : blocks)
+    {
+        if (block.x < 0 || block.x >= board.width || block.y >= board.height)
+            return true;
+        if (block.y >= 0 && isSandboxOccupied(board, block.x, block.y))
+            return true;
+    }
+    return false;
+}
+
+bool moveSandboxTetromino(Tetromino& tetromino, int dx, int dy, const SandboxBoard& board)
+{
+    Tetromino movedTetromino = tetromino;
+    movedTetromino.x += dx;
+    movedTetromino.y += dy;
+    if (checkSandboxCollision(movedTetromino, board))
+        return false;
+
+    tetromino = movedTetromino;
+    return true;
+}
+
+bool rotateSandboxTetromino(Tetromino& tetromino, const SandboxBoard& board)
+{
+    if (tetromino.type == PIECE_SQUARE)
+        return false; // No rotation for square
+
+    int count;
+    const Kick* kicks = getKicks(tetromino.type, tetromino.rotation, count);
+    for (int i = 0; i < count; ++i)
+    {
+        Tetromino rotatedTetromino = tetromino;
+        rotatedTetromino.rotation = (tetromino.rotation + 1) % ROTATION_COUNT;
+        rotatedTetromino.x += kicks[i].x;
+        rotatedTetromino.y += kicks[i].y;
+        if (!checkSandboxCollision(rotatedTetromino, board))
+        {
+            tetromino = rotatedTetromino;
+            return true;
+        }
+    }
+    return false;
+}
+
+void dropSandboxTetromino(Tetromino& tetromino, const SandboxBoard& board)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    int left = blocks[0].x, right = blocks[0].x, top = blocks[0].y, bottom = blocks[0].y;
+    for (const Block& block : blocks)
+    {
+        left = block.x < left ? block.x : left;
+        right = block.x > right ? block.x : right;
+        top = block.y < top ? block.y : top;
+        bottom = block.y > bottom ? block.y : bottom;
+    }
+
+    // Falls a whole chunk row at a time while everything it sweeps through is the empty chunk, and a row
+    // at a time once something is near
+    while (bottom + 1 < board.height)
+    {
+        int target = (((bottom + 1) >> SANDBOX_CHUNK_SHIFT) + 1) * SANDBOX_CHUNK_SIZE - 1;
+        target = target < board.height - 1 ? target : board.height - 1;
+        int sweptTop = top + 1 > 0 ? top + 1 : 0;
+        int distance;
+        if (isSandboxAreaEmpty(board, left, right, sweptTop, target))
+        {
+            distance = target - bottom;
+            tetromino.y += distance;
+        }
+        else if (moveSandboxTetromino(tetromino, 0, 1, board))
+            distance = 1;
+        else
+            break;
+
+        top += distance;
+        bottom += distance;
+    }
+}
+
+void placeSandboxTetromino(const Tetromino& tetromino, SandboxBoard& board)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (const Block& block : blocks)
+    {
+        if (block.y < 0)
+            continue;
+
+        int chunkX = block.x >> SANDBOX_CHUNK_SHIFT;
+        int chunkY = block.y >> SANDBOX_CHUNK_SHIFT;
+        uint32_t index = board.grid[(size_t)chunkY * board.chunkColumns + chunkX];
+        if (index == SANDBOX_EMPTY_CHUNK)
+            index = allocateChunk(board, chunkX, chunkY);
+
+        SandboxChunk& chunk = board.chunks[index];
+        chunk.rows[block.y & CHUNK_MASK] |= 1ull << (block.x & CHUNK_MASK);
+        ++chunk.cellCount;
+    }
+}
+
+static bool isSandboxRowFull(const SandboxBoard& board, int y)
+{
+    int chunkY = y >> SANDBOX_CHUNK_SHIFT;
+    int lastColumns = board.width & CHUNK_MASK;
+    for (int chunkX = 0; chunkX < board.chunkColumns; ++chunkX)
+    {
+        uint64_t full = chunkX == board.chunkColumns - 1 && lastColumns != 0 ? (1ull << lastColumns) - 1 : ~0ull;
+        if (getSandboxChunk(board, chunkX, chunkY).rows[y & CHUNK_MASK] != full)
+            return false; // Usually the first empty chunk
+    }
+    return true;
+}
+
+// Drops everything above row y by one, one chunk column at a time. Each chunk takes the bottom row of
+// the chunk above as its new top row; chunks that neither hold nor receive anything are skipped.
+static void removeSandboxRow(SandboxBoard& board, int y)
+{
+    int removedChunkY = y >> SANDBOX_CHUNK_SHIFT;
+    for (int chunkX = 0; chunkX < board.chunkColumns; ++chunkX)
+    {
+        for (int chunkY = removedChunkY; chunkY >= 0; --chunkY)
+        {
+            uint64_t incoming = chunkY > 0 ? getSandboxChunk(board, chunkX, chunkY - 1).rows[CHUNK_MASK] : 0;
+            uint32_t index = board.grid[(size_t)chunkY * board.chunkColumns + chunkX];
+            if (index == SANDBOX_EMPTY_CHUNK)
+            {
+                if (incoming == 0)
+                    continue;
+                index = allocateChunk(board, chunkX, chunkY);
+            }
+
+            SandboxChunk& chunk = board.chunks[index];
+            int removedRow = chunkY == removedChunkY ? y & CHUNK_MASK : CHUNK_MASK;
+            int removedCells = std::popcount(chunk.rows[removedRow]);
+            memmove(chunk.rows + 1, chunk.rows, sizeof(uint64_t) * removedRow);
+            chunk.rows[0] = incoming;
+            chunk.cellCount += std::popcount(incoming) - removedCells;
+            if (chunk.cellCount == 0)
+                releaseChunk(board, index);
+        }
+    }
+}
+
+int clearSandboxLines(SandboxBoard& board, int top, int bottom)
+{
+    top = top > 0 ? top : 0;
+    int cleared = 0;
+    for (int y = top; y <= bottom; ++y)
+    {
+        // Clearing moves only the rows above y, which were already found not to be full
+        if (isSandboxRowFull(board, y))
+        {
+            removeSandboxRow(board, y);
+            ++cleared;
+        }
+    }
+    return cleared;
+}
+
+static void spawnSandboxTetromino(SandboxGame& game)
+{
+    game.current = createTetromino(nextRandom(game.rng) % PIECE_TYPE_COUNT, game.board.width);
+    if (checkSandboxCollision(game.current, game.board))
+        game.isGameOver = true;
+}
+
+bool resetSandboxGame(SandboxGame& game, int width, int height, uint64_t seed)
+{
+    if (!createSandboxBoard(game.board, width, height))
+        return false;
+
+    seedRng(game.rng, seed);
+    game.linesCleared = 0;
+    game.piecesPlaced = 0;
+    game.isGameOver = false;
+    spawnSandboxTetromino(game);
+    return true;
+}
+
+int lockSandboxTetromino(SandboxGame& game)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(game.current, blocks);
+    int top = blocks[0].y, bottom = blocks[0].y;
+    for (const Block& block : blocks)
+    {
+        top = block.y < top ? block.y : top;
+        bottom = block.y > bottom ? block.y : bottom;
+    }
+
+    placeSandboxTetromino(game.current, game.board);
+    int lines = clearSandboxLines(game.board, top, bottom);
+    game.linesCleared += lines;
+    game.piecesPlaced++;
+    spawnSandboxTetromino(game);
+    return lines;
+}
+
+void applySandboxGravity(SandboxGame& game)
+{
+    if (!moveSandboxTetromino(game.current, 0, 1, game.board))
+        lockSandboxTetromino(game);
+}
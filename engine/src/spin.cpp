@@ -0,0 +1,46 @@
+#include "spin.h"
+
+#include <bit>
+
+// The 3x3 window around the pivot packs bit (dy + 1) * 3 + (dx + 1), so its corners are bits 0, 2, 6 and 8
+const uint32_t WINDOW_CORNERS = 0x145;
+
+// The two corners on the side the T points at, per rotation: down, left, up, right
+static constexpr uint32_t FRONT_CORNERS[ROTATION_COUNT] = { 0x140, 0x041, 0x005, 0x104 };
+
+template <int Width, int Height>
+static uint32_t getWindow(const BasicBoard<Width, Height>& board, int x, int y)
+{
+    int shift = x - 1 + PIECE_MASK_PAD;
+    uint32_t window = 0;
+    for (int dy = -1; dy <= 1; ++dy)
+        window |= (uint32_t)((getPaddedRow(board, y + dy) >> shift) & 7) << ((dy + 1) * 3);
+    return window;
+}
+
+template <int Width, int Height>
+SpinType detectSpin(const BasicBoard<Width, Height>& board, const Tetromino& tetromino, bool isLastMoveRotation)
+{
+    if (!isLastMoveRotation)
+        return SPIN_NONE;
+
+    if (tetromino.type == PIECE_T)
+    {
+        uint32_t window = getWindow(board, tetromino.x, tetromino.y);
+        if (std::popcount(window & WINDOW_CORNERS) < 3)
+            return SPIN_NONE;
+        uint32_t front = FRONT_CORNERS[tetromino.rotation];
+        return (window & front) == front ? SPIN_FULL : SPIN_MINI;
+    }
+
+    const PieceMask& mask = getPieceMask(tetromino.type, tetromino.rotation);
+    bool isImmobile = collidesAt(board, mask, tetromino.x - 1, tetromino.y)
+        && collidesAt(board, mask, tetromino.x + 1, tetromino.y)
+        && collidesAt(board, mask, tetromino.x, tetromino.y - 1);
+    return isImmobile ? SPIN_MINI : SPIN_NONE;
+}
+
+#define INSTANTIATE_SPIN(Width, Height) \
+    template SpinType detectSpin(const BasicBoard<Width, Height>&, const Tetromino&, bool);
+
+FOR_EACH_BOARD_SIZE(INSTANTIATE_SPIN)
@@ -0,0 +1,136 @@
+#include "symmetry.h"
+
+// Mirroring a pose keeps the rows and reverses the columns: rotation r of a piece becomes some
+// rotation of its mirror with the pivot moved by a fixed amount
+struct MirrorPose
+{
+    int rotation;
+    int offset; // Mirrored pivot x = BOARD_WIDTH - 1 - x + offset
+};
+
+struct MirrorPoseTable
+{
+    MirrorPose poses[PIECE_TYPE_COUNT][ROTATION_COUNT];
+};
+
+static bool hasSameCells(const Block* a, const Block* b)
+{
+    for (int i = 0; i < TETROMINO_SIZE; ++i)
+    {
+        bool isFound = false;
+        for (int j = 0; j < TETROMINO_SIZE && !isFound; ++j)
+            isFound = a[i].x == b[j].x && a[i].y == b[j].y;
+        if (!isFound)
+            return false;
+    }
+    return true;
+}
+
+static MirrorPose findMirrorPose(int type, int rotation)
+{
+    const int pivotX = BOARD_WIDTH / 2;
+    Tetromino tetromino = {};
+    tetromino.type = type;
+    tetromino.rotation = rotation;
+    tetromino.x = pivotX;
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (Block& block : blocks)
+        block.x = BOARD_WIDTH - 1 - block.x;
+
+    // Search the mirrored type's poses for the one covering the same cells
+    Tetromino mirrored = {};
+    mirrored.type = mirrorPieceType(type);
+    for (mirrored.rotation = 0; mirrored.rotation < ROTATION_COUNT; ++mirrored.rotation)
+    {
+        for (int offset = -2; offset <= 2; ++offset)
+        {
+            mirrored.x = BOARD_WIDTH - 1 - pivotX + offset;
+            Block mirroredBlocks[TETROMINO_SIZE];
+            getBlocks(mirrored, mirroredBlocks);
+            if (hasSameCells(blocks, mirroredBlocks))
+                return { mirrored.rotation, offset };
+        }
+    }
+    return { rotation, 0 };
+}
+
+static MirrorPoseTable buildMirrorPoses()
+{
+    MirrorPoseTable table = {};
+    for (int type = 0; type < PIECE_TYPE_COUNT; ++type)
+    {
+        for (int rotation = 0; rotation < ROTATION_COUNT; ++rotation)
+            table.poses[type][rotation] = findMirrorPose(type, rotation);
+    }
+    return table;
+}
+
+static const MirrorPoseTable MIRROR_POSES = buildMirrorPoses();
+
+int mirrorPieceType(int type)
+{
+    if (type == PIECE_L)
+        return PIECE_REVERSE_L;
+    if (type == PIECE_REVERSE_L)
+        return PIECE_L;
+    return type;
+}
+
+void mirrorBoard(const Board& board, Board& mirrored)
+{
+    const int swappedBits = PIECE_L ^ PIECE_REVERSE_L;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        mirrored.rows[y] = mirrorRow(board.rows[y]);
+        for (int b = 0; b < PALETTE_BITS; ++b)
+            mirrored.palette[b][y] = mirrorRow(board.palette[b][y]);
+
+        // Mirrored L cells belong to a reverse L and the other way round, so trade their colors too
+        Row swapped = getPaletteCells(mirrored, y, PIECE_L) | getPaletteCells(mirrored, y, PIECE_REVERSE_L);
+        for (int b = 0; b < PALETTE_BITS; ++b)
+        {
+            if ((swappedBits >> b) & 1)
+                mirrored.palette[b][y] ^= swapped;
+        }
+    }
+}
+
+Tetromino mirrorTetromino(const Tetromino& tetromino)
+{
+    const MirrorPose& pose = MIRROR_POSES.poses[tetromino.type][tetromino.rotation];
+    Tetromino mirrored = tetromino;
+    mirrored.type = mirrorPieceType(tetromino.type);
+    mirrored.rotation = pose.rotation;
+    mirrored.x = BOARD_WIDTH - 1 - tetromino.x + pose.offset;
+    return mirrored;
+}
+
+bool canonicalizePosition(const Board& board, const int* pieces, int pieceCount, Board& canonical, int* canonicalPieces)
+{
+    // Compare without building the mirror unless it wins
+    int order = 0;
+    for (int y = BOARD_HEIGHT - 1; y >= 0 && order == 0; --y)
+    {
+        Row mirrored = mirrorRow(board.rows[y]);
+        order = mirrored < board.rows[y] ? -1 : mirrored > board.rows[y] ? 1 : 0;
+    }
+    for (int i = 0; i < pieceCount && order == 0; ++i)
+    {
+        int mirrored = mirrorPieceType(pieces[i]);
+        order = mirrored < pieces[i] ? -1 : mirrored > pieces[i] ? 1 : 0;
+    }
+
+    if (order >= 0)
+    {
+        canonical = board;
+        for (int i = 0; i < pieceCount; ++i)
+            canonicalPieces[i] = pieces[i];
+        return false;
+    }
+
+    mirrorBoard(board, canonical);
+    for (int i = 0; i < pieceCount; ++i)
+        canonicalPieces[i] = mirrorPieceType(pieces[i]);
+    return true;
+}
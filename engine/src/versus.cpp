@@ -0,0 +1,72 @@
+#include "versus.h"
+
+const uint64_t GARBAGE_SEED_SALT = 0x6A09E667F3BCC909ull;
+
+static void pushAttack(GarbageQueue& queue, int lines, int hole)
+{
+    queue.pending += (uint16_t)lines;
+    if (queue.count == GARBAGE_QUEUE_CAPACITY)
+    {
+        // Full: the newest attack grows instead, keeping its hole
+        int last = (queue.head + queue.count - 1) & (GARBAGE_QUEUE_CAPACITY - 1);
+        queue.lines[last] = (uint8_t)(queue.lines[last] + lines < 255 ? queue.lines[last] + lines : 255);
+        return;
+    }
+
+    int tail = (queue.head + queue.count) & (GARBAGE_QUEUE_CAPACITY - 1);
+    queue.lines[tail] = (uint8_t)lines;
+    queue.holes[tail] = (uint8_t)hole;
+    ++queue.count;
+}
+
+// Removes up to lines from the front of the queue and returns how many that was; hole is the front attack's
+static int takeGarbage(GarbageQueue& queue, int lines, int& hole)
+{
+    if (queue.count == 0)
+        return 0;
+
+    hole = queue.holes[queue.head];
+    int taken = queue.lines[queue.head] < lines ? queue.lines[queue.head] : lines;
+    queue.lines[queue.head] = (uint8_t)(queue.lines[queue.head] - taken);
+    queue.pending = (uint16_t)(queue.pending - taken);
+    if (queue.lines[queue.head] == 0)
+    {
+        queue.head = (uint8_t)((queue.head + 1) & (GARBAGE_QUEUE_CAPACITY - 1));
+        --queue.count;
+    }
+    return taken;
+}
+
+void resetVersusGarbage(VersusGarbage& garbage, uint64_t seed)
+{
+    garbage = {};
+    seedRng(garbage.rng, seed ^ GARBAGE_SEED_SALT);
+}
+
+void resolveLock(VersusGarbage& garbage, Game players[VERSUS_PLAYERS], int player, int linesCleared)
+{
+    GarbageQueue& own = garbage.queues[player];
+    int attack = ATTACK_LINES[players[player].lastSpin][linesCleared];
+    int hole;
+    while (attack > 0 && own.count > 0)
+        attack -= takeGarbage(own, attack, hole);
+
+    if (attack > 0)
+    {
+        int opponent = 1 - player;
+        pushAttack(garbage.queues[opponent], attack, (int)(nextRandom(garbage.rng) % BOARD_WIDTH));
+        garbage.linesSent[player] += attack;
+    }
+
+    // Each attack rises with its own hole column
+    if (linesCleared == 0)
+    {
+        int rising = MAX_GARBAGE_PER_LOCK;
+        while (rising > 0 && own.count > 0 && !players[player].isGameOver)
+        {
+            int lines = takeGarbage(own, rising, hole);
+            insertGarbageRows(players[player], lines, hole);
+            rising -= lines;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * Stable C ABI for driving the game without SDL, e.g. from training frameworks.
+ *
+ * Every call writes its results straight into buffers owned by the caller, so an
+ * array allocated by the framework can be filled in place without any copies.
+ * Layouts below are part of the ABI: only append fields and bump TETRIS_ABI_VERSION.
+ */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(TETRIS_ENV_EXPORTS)
+#define TETRIS_API __declspec(dllexport)
+#else
+#define TETRIS_API __declspec(dllimport)
+#endif
+#else
+#define TETRIS_API __attribute__((visibility("default")))
+#endif
+
+#define TETRIS_ABI_VERSION 1
+
+#define TETRIS_BOARD_WIDTH 10
+#define TETRIS_BOARD_HEIGHT 20
+#define TETRIS_QUEUE_SIZE 5
+#define TETRIS_ROTATION_COUNT 4
+
+/* Action a places the current piece with rotation a / TETRIS_BOARD_WIDTH and pivot column a % TETRIS_BOARD_WIDTH */
+#define TETRIS_ACTION_COUNT (TETRIS_ROTATION_COUNT * TETRIS_BOARD_WIDTH)
+
+#define TETRIS_OK 0
+#define TETRIS_ERROR_INVALID_ARGUMENT -1
+#define TETRIS_ERROR_ILLEGAL_ACTION -2
+#define TETRIS_ERROR_GAME_OVER -3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TetrisEnv TetrisEnv;
+
+/* 52 bytes, no implicit padding */
+typedef struct TetrisObservation
+{
+    uint16_t board[TETRIS_BOARD_HEIGHT]; /* Row masks, board[0] is the top line, bit x is column x */
+    int8_t pieceType;
+    int8_t pieceRotation;
+    int8_t pieceX; /* Pivot block position */
+    int8_t pieceY;
+    int8_t queue[TETRIS_QUEUE_SIZE]; /* Upcoming piece types, queue[0] spawns next */
+    uint8_t isGameOver;
+    uint8_t reserved[2];
+} TetrisObservation;
+
+typedef struct TetrisStepInfo
+{
+    int32_t linesCleared;      /* Lines cleared by this step */
+    int32_t totalLinesCleared;
+    int32_t piecesPlaced;
+    int32_t isGameOver;
+} TetrisStepInfo;
+
+TETRIS_API uint32_t tetris_abi_version(void);
+
+TETRIS_API TetrisEnv* tetris_create(void);
+TETRIS_API void tetris_destroy(TetrisEnv* env);
+
+/* Starts a new game; the same seed always yields the same piece sequence */
+TETRIS_API int tetris_reset(TetrisEnv* env, uint64_t seed, TetrisObservation* observation);
+
+/* Places the current piece; observation and info may be null */
+TETRIS_API int tetris_step(TetrisEnv* env, int32_t action, TetrisObservation* observation, TetrisStepInfo* info);
+
+/* Writes TETRIS_ACTION_COUNT bytes (1 = legal) and returns the number of legal actions */
+TETRIS_API int tetris_legal_actions(const TetrisEnv* env, uint8_t* mask);
+
+/* Draws the playfield into a 32-bit RGBA buffer; pitch is in bytes */
+TETRIS_API int tetris_render_to_buffer(const TetrisEnv* env, uint8_t* pixels, int32_t width, int32_t height, int32_t pitch);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,173 @@
+#include "tetris_env.h"
+#include "game.h"
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+static_assert(TETRIS_BOARD_WIDTH == BOARD_WIDTH && TETRIS_BOARD_HEIGHT == BOARD_HEIGHT, "ABI board size out of sync with the engine");
+static_assert(TETRIS_QUEUE_SIZE == NEXT_QUEUE_SIZE, "ABI queue size out of sync with the engine");
+static_assert(TETRIS_ROTATION_COUNT == ROTATION_COUNT, "ABI rotation count out of sync with the engine");
+static_assert(sizeof(TetrisObservation) == 52, "TetrisObservation layout is part of the ABI");
+static_assert(std::is_trivially_copyable<Game>::value, "Game must stay a plain blob");
+
+struct TetrisEnv
+{
+    Game game;
+};
+
+static void writeObservation(const Game& game, TetrisObservation* observation)
+{
+    if (observation == nullptr)
+        return;
+
+    memcpy(observation->board, game.board.rows, sizeof(observation->board));
+    observation->pieceType = (int8_t)game.current.type;
+    observation->pieceRotation = (int8_t)game.current.rotation;
+    observation->pieceX = (int8_t)game.current.x;
+    observation->pieceY = (int8_t)game.current.y;
+    for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+        observation->queue[i] = (int8_t)game.queue[i];
+    observation->isGameOver = game.isGameOver ? 1 : 0;
+    observation->reserved[0] = 0;
+    observation->reserved[1] = 0;
+}
+
+static void fillCell(uint8_t* pixels, int32_t pitch, int cellSize, int x, int y, Color color)
+{
+    for (int py = 0; py < cellSize; ++py)
+    {
+        uint8_t* pixel = pixels + (size_t)(y * cellSize + py) * pitch + (size_t)x * cellSize * 4;
+        for (int px = 0; px < cellSize; ++px)
+        {
+            pixel[0] = color.r;
+            pixel[1] = color.g;
+            pixel[2] = color.b;
+            pixel[3] = color.a;
+            pixel += 4;
+        }
+    }
+}
+
+static void fillTetromino(uint8_t* pixels, int32_t pitch, int cellSize, const Tetromino& tetromino, Color color)
+{
+    Block blocks[TETROMINO_SIZE];
+    getBlocks(tetromino, blocks);
+    for (const Block& block : blocks)
+    {
+        if (block.y >= 0)
+            fillCell(pixels, pitch, cellSize, block.x, block.y, color);
+    }
+}
+
+extern "C" {
+
+uint32_t tetris_abi_version(void)
+{
+    return TETRIS_ABI_VERSION;
+}
+
+TetrisEnv* tetris_create(void)
+{
+    TetrisEnv* env = new (std::nothrow) TetrisEnv;
+    if (env != nullptr)
+        resetGame(env->game, 0);
+    return env;
+}
+
+void tetris_destroy(TetrisEnv* env)
+{
+    delete env;
+}
+
+int tetris_reset(TetrisEnv* env, uint64_t seed, TetrisObservation* observation)
+{
+    if (env == nullptr)
+        return TETRIS_ERROR_INVALID_ARGUMENT;
+
+    resetGame(env->game, seed);
+    writeObservation(env->game, observation);
+    return TETRIS_OK;
+}
+
+int tetris_step(TetrisEnv* env, int32_t action, TetrisObservation* observation, TetrisStepInfo* info)
+{
+    if (env == nullptr || action < 0 || action >= TETRIS_ACTION_COUNT)
+        return TETRIS_ERROR_INVALID_ARGUMENT;
+    if (env->game.isGameOver)
+        return TETRIS_ERROR_GAME_OVER;
+
+    Placement placement = { action / BOARD_WIDTH, action % BOARD_WIDTH };
+    int lines = applyPlacement(env->game, placement);
+    if (lines < 0)
+        return TETRIS_ERROR_ILLEGAL_ACTION;
+
+    writeObservation(env->game, observation);
+    if (info != nullptr)
+    {
+        info->linesCleared = lines;
+        info->totalLinesCleared = env->game.linesCleared;
+        info->piecesPlaced = env->game.piecesPlaced;
+        info->isGameOver = env->game.isGameOver ? 1 : 0;
+    }
+    return TETRIS_OK;
+}
+
+int tetris_legal_actions(const TetrisEnv* env, uint8_t* mask)
+{
+    if (env == nullptr || mask == nullptr)
+        return TETRIS_ERROR_INVALID_ARGUMENT;
+
+    int count = 0;
+    for (int action = 0; action < TETRIS_ACTION_COUNT; ++action)
+    {
+        Placement placement = { action / BOARD_WIDTH, action % BOARD_WIDTH };
+        Tetromino result;
+        bool isLegal = !env->game.isGameOver && findPlacement(env->game, placement, result);
+        mask[action] = isLegal ? 1 : 0;
+        count += isLegal;
+    }
+    return count;
+}
+
+int tetris_render_to_buffer(const TetrisEnv* env, uint8_t* pixels, int32_t width, int32_t height, int32_t pitch)
+{
+    if (env == nullptr || pixels == nullptr || pitch < width * 4)
+        return TETRIS_ERROR_INVALID_ARGUMENT;
+
+    int cellSize = width / BOARD_WIDTH < height / BOARD_HEIGHT ? width / BOARD_WIDTH : height / BOARD_HEIGHT;
+    if (cellSize <= 0)
+        return TETRIS_ERROR_INVALID_ARGUMENT;
+
+    // Black background
+    for (int32_t y = 0; y < height; ++y)
+    {
+        uint8_t* row = pixels + (size_t)y * pitch;
+        memset(row, 0, (size_t)width * 4);
+        for (int32_t x = 0; x < width; ++x)
+            row[x * 4 + 3] = 255;
+    }
+
+    const Game& game = env->game;
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        for (int x = 0; x < BOARD_WIDTH; ++x)
+        {
+            if (isOccupied(game.board, x, y))
+                fillCell(pixels, pitch, cellSize, x, y, PALETTE[getCellPalette(game.board, x, y)]);
+        }
+    }
+
+    if (!game.isGameOver)
+    {
+        Tetromino ghostTetromino = game.current;
+        dropTetromino(ghostTetromino, game.board);
+        const Color& color = PALETTE[game.current.type];
+        Color ghostColor = { (uint8_t)(color.r / 2), (uint8_t)(color.g / 2), (uint8_t)(color.b / 2), color.a };
+        fillTetromino(pixels, pitch, cellSize, ghostTetromino, ghostColor);
+        fillTetromino(pixels, pitch, cellSize, game.current, color);
+    }
+    return TETRIS_OK;
+}
+
+}
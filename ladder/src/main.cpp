@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "evaluator.h"
+#include "neural_evaluator.h"
+#include "versus.h"
+
+// Bot against bot versus rounds as fast as they can be played: pieces are placed directly rather
+// than ticked, one piece per player in turn, with garbage settled after every lock.
+int main(int argc, char* argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+    uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1;
+    int maxPieces = argc > 3 ? atoi(argv[3]) : 500;
+    if (rounds < 1 || maxPieces < 1)
+    {
+        std::cerr << "Usage: ladder [rounds=1000] [seed=1] [maxPieces=500] [weights for player 1]" << std::endl;
+        return 1;
+    }
+
+    HeuristicEvaluator heuristicEvaluator;
+    NeuralEvaluator neuralEvaluator;
+    Evaluator* evaluators[VERSUS_PLAYERS] = { &heuristicEvaluator, &heuristicEvaluator };
+    if (argc > 4)
+    {
+        if (!neuralEvaluator.load(argv[4]))
+        {
+            std::cerr << "Could not load weights from " << argv[4] << std::endl;
+            return 1;
+        }
+        evaluators[1] = &neuralEvaluator;
+    }
+
+    int wins[VERSUS_PLAYERS] = {};
+    int draws = 0;
+    uint64_t locks = 0;
+    uint64_t linesSent = 0;
+    Game players[VERSUS_PLAYERS];
+    VersusGarbage garbage;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (Game& player : players)
+            resetGame(player, seed + round);
+        resetVersusGarbage(garbage, seed + round);
+
+        while (!players[0].isGameOver && !players[1].isGameOver && players[1].piecesPlaced < maxPieces)
+        {
+            int turn = players[0].piecesPlaced <= players[1].piecesPlaced ? 0 : 1;
+            Placement placement;
+            if (!choosePlacement(players[turn], *evaluators[turn], placement))
+            {
+                players[turn].isGameOver = true;
+                break;
+            }
+            int lines = applyPlacement(players[turn], placement);
+            resolveLock(garbage, players, turn, lines);
+            ++locks;
+        }
+
+        if (players[0].isGameOver == players[1].isGameOver)
+            ++draws;
+        else
+            ++wins[players[0].isGameOver ? 1 : 0];
+        linesSent += garbage.linesSent[0] + garbage.linesSent[1];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("rounds: %d (player 0 %d, player 1 %d, draws %d)\n", rounds, wins[0], wins[1], draws);
+    printf("locks: %llu, garbage lines sent: %llu (%.1f per round)\n", (unsigned long long)locks, (unsigned long long)linesSent,
+        (double)linesSent / rounds);
+    printf("%.1f rounds/s, %.0f locks/s\n", rounds / seconds, locks / seconds);
+    return 0;
+}
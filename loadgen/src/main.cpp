@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "net_protocol.h"
+#include "pathfinder.h"
+#include "replication.h"
+
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int CLIENT_BUFFER_SIZE = 1024;
+const int SENT_TIMES = 256; // Send times kept per client, by input sequence
+const int HELLO_RETRY_MILLISECONDS = 1000;
+const int SPECTATE_REPEAT_MILLISECONDS = 2000; // UDP spectators only listen, so they repeat the request to stay alive
+
+// One simulated player or spectator: a socket, its read buffer and when each recent input went out
+struct Client
+{
+    int fd;
+    bool isWelcomed; // For a spectator: sent NET_SPECTATE
+    bool isSpectator;
+    uint32_t sessionId;
+    int watchedClient; // Player whose session a spectator watches
+    uint16_t sequence;
+    uint16_t measuredSequence; // Latest acknowledged input already counted
+    int64_t nextInputMicroseconds;
+    int64_t helloMicroseconds;
+    int64_t sentMicroseconds[SENT_TIMES];
+    uint8_t input[CLIENT_BUFFER_SIZE];
+    int inputSize;
+    ReplicationDecoder decoder;
+};
+
+struct LoadStats
+{
+    uint64_t states;
+    uint64_t bytes;
+    uint64_t inputs;
+    uint64_t frames;         // Replication frames applied by spectators
+    uint64_t spectatorBytes; // What those spectators received
+    uint64_t resyncs;        // Frames a spectator could not apply and waited out until a keyframe
+    std::vector<int64_t> latencies; // Input sent to the first state acknowledging it, in microseconds
+};
+
+static int64_t getMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void handleMessage(Client& client, const uint8_t* message, int size, LoadStats& stats)
+{
+    if (message[0] == NET_WELCOME)
+    {
+        client.isWelcomed = true;
+        client.sessionId = readU32(message + 4);
+        return;
+    }
+    if (message[0] == NET_REPLICATION)
+    {
+        if (decodeReplicationFrame(client.decoder, message, size))
+            ++stats.frames;
+        else
+            ++stats.resyncs;
+        return;
+    }
+    if (message[0] != NET_STATE)
+        return;
+
+    ++stats.states;
+    uint16_t acked = readU16(message + 2);
+    if (acked != client.measuredSequence && (uint16_t)(client.sequence - acked) < SENT_TIMES)
+    {
+        stats.latencies.push_back(getMicroseconds() - client.sentMicroseconds[acked % SENT_TIMES]);
+        client.measuredSequence = acked;
+    }
+}
+
+// Parses whole messages from the stream or datagram and keeps any partial one for later
+static bool receive(Client& client, LoadStats& stats)
+{
+    for (;;)
+    {
+        ssize_t received = recv(client.fd, client.input + client.inputSize, CLIENT_BUFFER_SIZE - client.inputSize, 0);
+        if (received == 0)
+            return false;
+        if (received < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        stats.bytes += received;
+        if (client.isSpectator)
+            stats.spectatorBytes += received;
+        client.inputSize += (int)received;
+        int offset = 0;
+        while (offset < client.inputSize)
+        {
+            int size = getNetMessageSize(client.input + offset, client.inputSize - offset);
+            if (size == 0)
+                return false;
+            if (size < 0 || client.inputSize - offset < size)
+                break;
+            handleMessage(client, client.input + offset, size, stats);
+            offset += size;
+        }
+        client.inputSize -= offset;
+        memmove(client.input, client.input + offset, client.inputSize);
+    }
+}
+
+static bool sendHello(Client& client, uint32_t seed)
+{
+    uint8_t hello[NET_HELLO_SIZE];
+    writeHelloMessage(hello, seed);
+    client.helloMicroseconds = getMicroseconds();
+    return send(client.fd, hello, sizeof(hello), MSG_NOSIGNAL) == sizeof(hello);
+}
+
+static bool sendSpectate(Client& client, uint32_t sessionId)
+{
+    uint8_t spectate[NET_SPECTATE_SIZE];
+    writeSpectateMessage(spectate, sessionId);
+    client.helloMicroseconds = getMicroseconds();
+    return send(client.fd, spectate, sizeof(spectate), MSG_NOSIGNAL) == sizeof(spectate);
+}
+
+static void raiseFileLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int clientCount = argc > 1 ? atoi(argv[1]) : 1000;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    bool isUdp = argc > 3 && strcmp(argv[3], "udp") == 0;
+    const char* address = argc > 4 ? argv[4] : "127.0.0.1";
+    int port = argc > 5 ? atoi(argv[5]) : 7777;
+    int inputsPerSecond = argc > 6 ? atoi(argv[6]) : 10;
+    int spectatorCount = argc > 7 ? atoi(argv[7]) : 0;
+    if (clientCount < 1 || seconds < 1 || inputsPerSecond < 1 || spectatorCount < 0)
+    {
+        std::cerr << "Usage: loadgen [clients=1000] [seconds=10] [tcp|udp] [address=127.0.0.1] [port=7777] [inputsPerSecond=10] [spectators=0]" << std::endl;
+        return 1;
+    }
+    raiseFileLimit();
+
+    sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address, &server.sin_addr) != 1)
+    {
+        std::cerr << "Bad address " << address << std::endl;
+        return 1;
+    }
+
+    // Spectators come after the players and watch them round robin
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    int playerCount = clientCount;
+    clientCount += spectatorCount;
+    std::vector<Client> clients(clientCount);
+    Rng rng;
+    seedRng(rng, 1);
+    const int64_t inputInterval = 1000000 / inputsPerSecond;
+    int64_t now = getMicroseconds();
+    for (int i = 0; i < clientCount; ++i)
+    {
+        // Connecting blocks, which on loopback is immediate; everything after that does not
+        Client& client = clients[i];
+        client = {};
+        client.fd = socket(AF_INET, (isUdp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_CLOEXEC, 0);
+        if (client.fd < 0 || connect(client.fd, (sockaddr*)&server, sizeof(server)) < 0)
+        {
+            std::cerr << "Client " << i << " could not connect: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        int isEnabled = 1;
+        if (!isUdp)
+            setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &isEnabled, sizeof(isEnabled));
+        fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) | O_NONBLOCK);
+
+        // Spread the inputs so the players do not all press at once
+        client.nextInputMicroseconds = now + (int64_t)(nextRandom(rng) % inputInterval);
+        client.isSpectator = i >= playerCount;
+        client.watchedClient = i % playerCount;
+        resetReplicationDecoder(client.decoder);
+        if (!client.isSpectator)
+            sendHello(client, (uint32_t)i + 1);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+    std::cout << playerCount << (isUdp ? " udp" : " tcp") << " players and " << spectatorCount << " spectators connected" << std::endl;
+
+    LoadStats stats = {};
+    LoadStats total = {};
+    int64_t start = getMicroseconds();
+    int64_t nextReport = start + 1000000;
+    int64_t end = start + (int64_t)seconds * 1000000;
+    int lost = 0;
+    epoll_event events[256];
+    while ((now = getMicroseconds()) < end)
+    {
+        int count = epoll_wait(epollFd, events, 256, 1);
+        for (int i = 0; i < count; ++i)
+        {
+            Client& client = clients[events[i].data.u32];
+            if (client.fd >= 0 && !receive(client, stats))
+            {
+                close(client.fd);
+                client.fd = -1;
+                ++lost;
+            }
+        }
+
+        now = getMicroseconds();
+        for (int i = 0; i < clientCount; ++i)
+        {
+            Client& client = clients[i];
+            if (client.fd < 0)
+                continue;
+
+            if (client.isSpectator)
+            {
+                // Watch once the player has a session
+                const Client& player = clients[client.watchedClient];
+                bool isDue = !client.isWelcomed || (isUdp && now - client.helloMicroseconds > SPECTATE_REPEAT_MILLISECONDS * 1000);
+                if (player.isWelcomed && isDue && sendSpectate(client, player.sessionId))
+                    client.isWelcomed = true;
+                continue;
+            }
+
+            // Datagrams can be lost, including the hello
+            if (!client.isWelcomed)
+            {
+                if (isUdp && now - client.helloMicroseconds > HELLO_RETRY_MILLISECONDS * 1000)
+                    sendHello(client, (uint32_t)i + 1);
+                continue;
+            }
+            if (now < client.nextInputMicroseconds)
+                continue;
+
+            uint8_t message[NET_INPUT_SIZE];
+            ++client.sequence;
+            writeInputMessage(message, (uint8_t)(1 << (nextRandom(rng) % MOVE_HARD_DROP)), client.sequence);
+            client.sentMicroseconds[client.sequence % SENT_TIMES] = now;
+            if (send(client.fd, message, sizeof(message), MSG_NOSIGNAL) == sizeof(message))
+                ++stats.inputs;
+            client.nextInputMicroseconds += inputInterval;
+        }
+
+        if (now >= nextReport)
+        {
+            int welcomed = 0;
+            for (const Client& client : clients)
+                welcomed += !client.isSpectator && client.isWelcomed && client.fd >= 0;
+
+            std::sort(stats.latencies.begin(), stats.latencies.end());
+            int64_t median = stats.latencies.empty() ? 0 : stats.latencies[stats.latencies.size() / 2];
+            int64_t p99 = stats.latencies.empty() ? 0 : stats.latencies[stats.latencies.size() * 99 / 100];
+            printf("%d playing, %d lost: %llu inputs, %llu states, %llu bytes, input to state median %.2f ms, p99 %.2f ms\n",
+                welcomed, lost, (unsigned long long)stats.inputs, (unsigned long long)stats.states, (unsigned long long)stats.bytes,
+                median / 1000.0, p99 / 1000.0);
+            if (spectatorCount > 0)
+                printf("  %d spectators: %llu frames, %llu resyncs, %.1f bytes and %.1f frames per spectator\n", spectatorCount,
+                    (unsigned long long)stats.frames, (unsigned long long)stats.resyncs, (double)stats.spectatorBytes / spectatorCount,
+                    (double)stats.frames / spectatorCount);
+
+            total.inputs += stats.inputs;
+            total.states += stats.states;
+            total.bytes += stats.bytes;
+            total.frames += stats.frames;
+            total.spectatorBytes += stats.spectatorBytes;
+            stats = {};
+            nextReport += 1000000;
+        }
+    }
+
+    for (Client& client : clients)
+    {
+        if (client.fd >= 0)
+            close(client.fd);
+    }
+    close(epollFd);
+    printf("total: %llu inputs, %llu states, %llu bytes\n", (unsigned long long)total.inputs, (unsigned long long)total.states,
+        (unsigned long long)total.bytes);
+    if (spectatorCount > 0 && total.frames > 0)
+        printf("spectators: %llu frames, %.1f bytes per frame\n", (unsigned long long)total.frames, (double)total.spectatorBytes / total.frames);
+    return lost == 0 ? 0 : 1;
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+    std::cerr << "loadgen needs Linux (epoll); build it with the CMakeLists.txt at the top of the tree" << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "opening_book.h"
+#include "pathfinder.h"
+#include "symmetry.h"
+
+// Every queue of OPENING_QUEUE_SIZE pieces
+static int getQueueCount()
+{
+    int count = 1;
+    for (int i = 0; i < OPENING_QUEUE_SIZE; ++i)
+        count *= PIECE_TYPE_COUNT;
+    return count;
+}
+
+static void getQueue(int index, int* pieces)
+{
+    for (int i = 0; i < OPENING_QUEUE_SIZE; ++i)
+    {
+        pieces[i] = index % PIECE_TYPE_COUNT;
+        index /= PIECE_TYPE_COUNT;
+    }
+}
+
+static bool fitsHeight(const Board& board, int maxHeight)
+{
+    for (int y = 0; y < BOARD_HEIGHT - maxHeight; ++y)
+    {
+        if (board.rows[y] != 0)
+            return false;
+    }
+    return true;
+}
+
+// Whether the placements, locked in order through the game's own movement rules, empty the board
+static bool replaysToClear(Board board, const PerfectClearSolution& solution)
+{
+    for (int i = 0; i < solution.count; ++i)
+    {
+        Reachability reachability;
+        findReachable(board, createTetromino(solution.placements[i].type), reachability);
+        Tetromino landed = solution.placements[i];
+        Tetromino below = landed;
+        if (!isReachable(reachability, landed) || moveTetromino(below, 0, 1, board))
+            return false;
+        placeTetromino(landed, board);
+        clearFullLines(board);
+    }
+
+    for (int y = 0; y < BOARD_HEIGHT; ++y)
+    {
+        if (board.rows[y] != 0)
+            return false;
+    }
+    return true;
+}
+
+// Canonical setups reachable from an empty board by locking up to depth pieces without leaving the clear height
+static std::vector<Board> enumerateSetups(int depth, int maxHeight)
+{
+    Board empty;
+    clearBoard(empty);
+    std::vector<Board> setups = { empty };
+    std::unordered_set<uint64_t> seen;
+    uint64_t key;
+    getOpeningBoardKey(empty, key);
+    seen.insert(key);
+
+    size_t begin = 0;
+    for (int d = 0; d < depth; ++d)
+    {
+        size_t end = setups.size();
+        for (size_t i = begin; i < end; ++i)
+        {
+            for (int type = 0; type < PIECE_TYPE_COUNT; ++type)
+            {
+                Board board = setups[i];
+                Reachability reachability;
+                findReachable(board, createTetromino(type), reachability);
+
+                Tetromino landed[PATH_STATE_COUNT];
+                int count = getLandedTetrominoes(reachability, board, landed);
+                for (int l = 0; l < count; ++l)
+                {
+                    Board next = board;
+                    placeTetromino(landed[l], next);
+                    clearFullLines(next);
+                    canonicalizePosition(next, nullptr, 0, next, nullptr);
+                    if (fitsHeight(next, maxHeight) && getOpeningBoardKey(next, key) && seen.insert(key).second)
+                        setups.push_back(next);
+                }
+            }
+        }
+        begin = end;
+    }
+    return setups;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: openings <output> [depth=1] [maxHeight=4] [none|srs|ars]" << std::endl;
+        return 1;
+    }
+
+    const char* path = argv[1];
+    int depth = argc > 2 ? atoi(argv[2]) : 1;
+    int maxHeight = argc > 3 ? atoi(argv[3]) : 4;
+    if (maxHeight < 1 || maxHeight > PC_MAX_HEIGHT)
+    {
+        std::cerr << "maxHeight must be between 1 and " << PC_MAX_HEIGHT << std::endl;
+        return 1;
+    }
+
+    // The book only opens under the rotation system it was solved with
+    RotationSystem rotationSystem = ROTATION_SRS;
+    if (argc > 4 && !findRotationSystem(argv[4], rotationSystem))
+    {
+        std::cerr << "Unknown rotation system " << argv[4] << std::endl;
+        return 1;
+    }
+    setRotationSystem(rotationSystem);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Board> setups = enumerateSetups(depth, maxHeight);
+    int queueCount = getQueueCount();
+    std::cout << "setups: " << setups.size() << ", queues per setup: " << queueCount << std::endl;
+
+    // Setups are independent, so each thread solves its own share with its own memo
+    int threadCount = (int)std::thread::hardware_concurrency();
+    threadCount = threadCount > 0 ? threadCount : 1;
+    std::vector<std::vector<OpeningEntry>> found(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            PerfectClearSolver solver;
+            for (size_t s = t; s < setups.size(); s += threadCount)
+            {
+                for (int q = 0; q < queueCount; ++q)
+                {
+                    int pieces[OPENING_QUEUE_SIZE];
+                    getQueue(q, pieces);
+
+                    // The mirrored queue on a symmetric setup is answered by its canonical twin
+                    Board canonical;
+                    int canonicalPieces[OPENING_QUEUE_SIZE];
+                    if (canonicalizePosition(setups[s], pieces, OPENING_QUEUE_SIZE, canonical, canonicalPieces))
+                        continue;
+
+                    PerfectClearSolution solution;
+                    if (!solvePerfectClear(solver, setups[s], pieces, OPENING_QUEUE_SIZE, maxHeight, 1, solution))
+                        continue;
+
+                    Board mirroredSetup;
+                    mirrorBoard(setups[s], mirroredSetup);
+                    PerfectClearSolution mirrored = solution;
+                    for (int i = 0; i < solution.count; ++i)
+                        mirrored.placements[i] = mirrorTetromino(solution.placements[i]);
+
+                    OpeningEntry entry;
+                    makeOpeningEntry(setups[s], pieces, solution, replaysToClear(mirroredSetup, mirrored), entry);
+                    found[t].push_back(entry);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::vector<OpeningEntry> entries;
+    for (const std::vector<OpeningEntry>& part : found)
+        entries.insert(entries.end(), part.begin(), part.end());
+    if (!writeOpeningBook(path, entries, maxHeight))
+    {
+        std::cerr << "Could not write " << path << std::endl;
+        return 1;
+    }
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Look every entry up again through the mapped file, from both sides of every mirror pair
+    OpeningBook book;
+    if (!openOpeningBook(book, path))
+    {
+        std::cerr << "Could not read back " << path << std::endl;
+        return 1;
+    }
+
+    start = std::chrono::steady_clock::now();
+    size_t hits = 0;
+    size_t lookups = 0;
+    for (const Board& setup : setups)
+    {
+        Board sides[2] = { setup };
+        mirrorBoard(setup, sides[1]);
+        for (const Board& side : sides)
+        {
+            for (int q = 0; q < queueCount; ++q, ++lookups)
+            {
+                int pieces[OPENING_QUEUE_SIZE];
+                getQueue(q, pieces);
+                PerfectClearSolution solution;
+                hits += findOpening(book, side, pieces, solution);
+            }
+        }
+    }
+    double lookupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Every answer, mirrored or not, has to replay to an empty board
+    for (const Board& setup : setups)
+    {
+        Board sides[2] = { setup };
+        mirrorBoard(setup, sides[1]);
+        for (const Board& side : sides)
+        {
+            for (int q = 0; q < queueCount; ++q)
+            {
+                int pieces[OPENING_QUEUE_SIZE];
+                getQueue(q, pieces);
+                PerfectClearSolution solution;
+                if (findOpening(book, side, pieces, solution) && !replaysToClear(side, solution))
+                {
+                    std::cerr << "Answer for queue " << q << " does not clear the board" << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+    size_t fileBytes = book.file.size;
+    closeOpeningBook(book);
+
+    std::cout << "entries: " << entries.size() << " (" << fileBytes << " bytes), answering " << hits << " of " << lookups << " lookups" << std::endl;
+    std::cout << "build: " << buildSeconds << " s, lookup: " << lookupSeconds * 1e9 / lookups << " ns" << std::endl;
+    return 0;
+}
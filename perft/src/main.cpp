@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "game.h"
+#include "perft.h"
+
+struct PerftGolden
+{
+    uint64_t seed;
+    int depth;
+    uint64_t nodes;
+};
+
+// Counts produced by the reference rules, which have no kicks; any change here means the rules changed
+static const PerftGolden GOLDEN_VALUES[] =
+{
+    { 1, 1, 34 },
+    { 1, 2, 313 },
+    { 1, 3, 10985 },
+    { 2, 1, 17 },
+    { 2, 2, 289 },
+    { 2, 3, 10084 },
+    { 3, 1, 17 },
+    { 3, 2, 153 },
+    { 3, 3, 5265 },
+    { 3, 4, 49782 },
+};
+
+static uint64_t runPerft(uint64_t seed, int depth, double& seconds)
+{
+    Game game;
+    resetGame(game, seed);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = perft(game, depth);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return nodes;
+}
+
+static void printResult(uint64_t seed, int depth, uint64_t nodes, double seconds)
+{
+    std::cout << "seed " << seed << " depth " << depth << ": " << nodes << " nodes, " << seconds << " s";
+    if (seconds > 0.0)
+        std::cout << ", " << (uint64_t)(nodes / seconds) << " nodes/s";
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: perft verify | perft <seed> <depth> [none|srs|ars]" << std::endl;
+        return 1;
+    }
+
+    if (strcmp(argv[1], "verify") == 0)
+    {
+        setRotationSystem(ROTATION_NONE);
+        int failures = 0;
+        for (const PerftGolden& golden : GOLDEN_VALUES)
+        {
+            double seconds;
+            uint64_t nodes = runPerft(golden.seed, golden.depth, seconds);
+            printResult(golden.seed, golden.depth, nodes, seconds);
+            if (nodes != golden.nodes)
+            {
+                std::cerr << "  MISMATCH: expected " << golden.nodes << std::endl;
+                ++failures;
+            }
+        }
+        std::cout << (failures == 0 ? "All perft counts match" : "Perft counts differ from the reference rules") << std::endl;
+        return failures == 0 ? 0 : 1;
+    }
+
+    if (argc < 3)
+    {
+        std::cerr << "Usage: perft verify | perft <seed> <depth> [none|srs|ars]" << std::endl;
+        return 1;
+    }
+
+    RotationSystem rotationSystem = ROTATION_SRS;
+    if (argc > 3 && !findRotationSystem(argv[3], rotationSystem))
+    {
+        std::cerr << "Unknown rotation system " << argv[3] << std::endl;
+        return 1;
+    }
+    setRotationSystem(rotationSystem);
+
+    uint64_t seed = strtoull(argv[1], nullptr, 10);
+    int depth = atoi(argv[2]);
+    for (int d = 1; d <= depth; ++d)
+    {
+        double seconds;
+        uint64_t nodes = runPerft(seed, d, seconds);
+        printResult(seed, d, nodes, seconds);
+    }
+    return 0;
+}
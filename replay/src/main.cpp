@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "checksum.h"
+#include "pathfinder.h"
+#include "replay.h"
+
+const char* USAGE = "Usage: replay <recording> | replay verify [seed=1] [ticks=20000]";
+const int VERIFY_MAX_LATENCY = 8; // Frames an input usually takes to reach the other side, 0 included
+const int VERIFY_SPIKE_LATENCY = 40; // One input in VERIFY_SPIKE_ODDS is held up this long, and everything behind it
+const int VERIFY_SPIKE_ODDS = 8;
+
+static_assert(ROLLBACK_PLAYERS == 2, "The verify run has each player send to the other");
+
+struct VerifyInput
+{
+    uint32_t tick;
+    uint8_t moves;
+    uint32_t arrival; // Frame it reaches the other side
+};
+
+// Offers inputs in order until one cannot be taken yet; it stays queued for the next frame
+static void deliverVerifyInputs(std::deque<VerifyInput>& inputs, RollbackSession& session, int player, uint32_t frame)
+{
+    while (!inputs.empty() && inputs.front().arrival <= frame && addRemoteInput(session, player, inputs.front().tick, inputs.front().moves))
+        inputs.pop_front();
+}
+
+// Two rollback sessions trade random inputs over a random lag, each advancing on its own so either can
+// run ahead of the other, and every tick both agree is final is compared against the same moves
+// stepped in lockstep. Returns the number of ticks that disagreed, or -1 if the sessions stopped advancing.
+static int verifyRollback(uint64_t seed, uint32_t ticks)
+{
+    RollbackSession* sessions = new RollbackSession[ROLLBACK_PLAYERS];
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+        startRollback(sessions[player], seed, player);
+    Match reference;
+    resetMatch(reference, seed);
+
+    Rng rng;
+    seedRng(rng, seed);
+    // Rollbacks are repaired on the next advance, so the sessions play on a little past the ticks compared
+    const uint32_t playedTicks = ticks + 2 * ROLLBACK_WINDOW;
+    std::vector<uint8_t> moves[ROLLBACK_PLAYERS];
+    for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+    {
+        for (uint32_t t = 0; t < playedTicks; ++t)
+            moves[player].push_back(nextRandom(rng) % 4 == 0 ? (uint8_t)(1 << (nextRandom(rng) % MOVE_COUNT)) : 0);
+    }
+
+    std::deque<VerifyInput> toPlayer[ROLLBACK_PLAYERS];
+    int mismatches = 0;
+    uint32_t compared = 0;
+    uint32_t idleFrames = 0;
+    for (uint32_t frame = 0; reference.tick < ticks; ++frame)
+    {
+        bool isAdvanced = false;
+        for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+        {
+            RollbackSession& session = sessions[player];
+            deliverVerifyInputs(toPlayer[player], session, 1 - player, frame);
+            if (session.match.tick >= playedTicks || nextRandom(rng) % 4 == 0)
+                continue;
+
+            uint32_t tick = session.match.tick;
+            if (advanceRollback(session, moves[player][tick]))
+            {
+                // Spikes longer than the window let one side stall and then take a burst of inputs at once
+                uint32_t latency = nextRandom(rng) % VERIFY_SPIKE_ODDS == 0 ? VERIFY_SPIKE_LATENCY : nextRandom(rng) % (VERIFY_MAX_LATENCY + 1);
+                toPlayer[1 - player].push_back({ tick, moves[player][tick], frame + latency });
+                isAdvanced = true;
+            }
+        }
+
+        // Both sides repair their predictions on their next advance, so compare what both call final
+        uint32_t confirmed = getConfirmedTicks(sessions[0]) < getConfirmedTicks(sessions[1]) ? getConfirmedTicks(sessions[0]) : getConfirmedTicks(sessions[1]);
+        while (reference.tick < confirmed && reference.tick < ticks)
+        {
+            uint8_t referenceMoves[ROLLBACK_PLAYERS] = { moves[0][reference.tick], moves[1][reference.tick] };
+            stepMatch(reference, referenceMoves);
+            Match match;
+            for (int player = 0; player < ROLLBACK_PLAYERS; ++player)
+            {
+                if (getMatchAt(sessions[player], reference.tick, match) && memcmp(&match, &reference, sizeof(match)) != 0)
+                    ++mismatches;
+            }
+            ++compared;
+        }
+
+        idleFrames = isAdvanced ? 0 : idleFrames + 1;
+        if (idleFrames > VERIFY_SPIKE_LATENCY * 16)
+        {
+            std::cerr << "Sessions stopped advancing at ticks " << sessions[0].match.tick << " and " << sessions[1].match.tick << std::endl;
+            delete[] sessions;
+            return -1;
+        }
+    }
+
+    std::cout << compared << " ticks compared, " << sessions[0].stats.rollbacks + sessions[1].stats.rollbacks << " rollbacks, "
+        << sessions[0].stats.stalls + sessions[1].stats.stalls << " stalls, " << mismatches << " mismatches" << std::endl;
+    delete[] sessions;
+    return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << USAGE << std::endl;
+        return 1;
+    }
+
+    if (strcmp(argv[1], "verify") == 0)
+    {
+        uint64_t seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1;
+        uint32_t ticks = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 20000;
+        int mismatches = verifyRollback(seed, ticks);
+        std::cout << (mismatches == 0 ? "Rollback matches lockstep" : "Rollback disagrees with lockstep") << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    ReplayResult result;
+    if (!playReplay(argv[1], result))
+    {
+        std::cerr << "Could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    if (result.desyncTick == NO_ROLLBACK)
+    {
+        std::cout << result.tickCount << " ticks replayed, checksums agree" << std::endl;
+        return 0;
+    }
+
+    // The recording only keeps checksums, so show the last agreeing tick next to the first diverging one
+    printf("desync at tick %u of %u: recorded %016llx, replayed %016llx\n", result.desyncTick, result.tickCount,
+        (unsigned long long)result.recordedChecksum, (unsigned long long)result.diverged.checksum);
+    printf("\nlast agreeing match\n");
+    dumpMatch(stdout, result.agreed);
+    printf("\nreplayed match after the desync\n");
+    dumpMatch(stdout, result.diverged);
+    return 1;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "sandbox.h"
+
+// Stress test for huge sandbox fields: pieces land in random columns and rotations as fast as they can
+// be placed, then the chunked storage is compared with what a dense field of ints would need.
+int main(int argc, char* argv[])
+{
+    int width = argc > 1 ? atoi(argv[1]) : 4096;
+    int height = argc > 2 ? atoi(argv[2]) : 4096;
+    int64_t pieces = argc > 3 ? strtoll(argv[3], nullptr, 10) : 1000000;
+    uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1;
+
+    SandboxGame* game = new SandboxGame;
+    if (pieces < 1 || !resetSandboxGame(*game, width, height, seed))
+    {
+        std::cerr << "Usage: sandbox [width=4096] [height=4096] [pieces=1000000] [seed=1], sides up to " << SANDBOX_MAX_SIZE << std::endl;
+        delete game;
+        return 1;
+    }
+
+    Rng rng;
+    seedRng(rng, seed + 1);
+    auto start = std::chrono::steady_clock::now();
+    while (!game->isGameOver && game->piecesPlaced < pieces)
+    {
+        // Spawned pieces sit at the top, so jumping straight to a column only needs the one collision test
+        Tetromino& current = game->current;
+        int rotations = nextRandom(rng) % ROTATION_COUNT;
+        for (int r = 0; r < rotations; ++r)
+            rotateSandboxTetromino(current, game->board);
+        Tetromino moved = current;
+        moved.x = (int)(nextRandom(rng) % width);
+        if (!checkSandboxCollision(moved, game->board))
+            current = moved;
+
+        dropSandboxTetromino(current, game->board);
+        lockSandboxTetromino(*game);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const SandboxBoard& board = game->board;
+    double denseBytes = (double)width * height * sizeof(int) + (double)height * 3 * sizeof(void*);
+    printf("field: %dx%d, %d x %d chunks of %dx%d\n", width, height, board.chunkColumns, board.chunkRows, SANDBOX_CHUNK_SIZE, SANDBOX_CHUNK_SIZE);
+    printf("pieces: %lld, lines: %lld%s\n", (long long)game->piecesPlaced, (long long)game->linesCleared, game->isGameOver ? ", topped out" : "");
+    printf("chunks in use: %zu of %zu, memory %.1f KB (dense ints %.1f MB)\n", board.occupied.size(), board.grid.size(),
+        getSandboxMemory(board) / 1024.0, denseBytes / (1024.0 * 1024.0));
+    printf("%.0f pieces/s\n", game->piecesPlaced / seconds);
+    delete game;
+    return 0;
+}
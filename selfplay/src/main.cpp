@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "dataset.h"
+#include "evaluator.h"
+#include "neural_evaluator.h"
+
+// What the same record would cost stored as an int grid plus int fields
+const size_t NAIVE_RECORD_BYTES = sizeof(int) * (BOARD_WIDTH * BOARD_HEIGHT + 1 + NEXT_QUEUE_SIZE + 3);
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: selfplay <output> [games=100] [seed=1] [maxPieces=2000] [weights]" << std::endl;
+        return 1;
+    }
+
+    const char* path = argv[1];
+    int games = argc > 2 ? atoi(argv[2]) : 100;
+    uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1;
+    int maxPieces = argc > 4 ? atoi(argv[4]) : 2000;
+
+    // Play with the heuristic unless a trained network is given
+    HeuristicEvaluator heuristicEvaluator;
+    NeuralEvaluator neuralEvaluator;
+    Evaluator* evaluator = &heuristicEvaluator;
+    if (argc > 5)
+    {
+        if (!neuralEvaluator.load(argv[5]))
+        {
+            std::cerr << "Could not load weights from " << argv[5] << std::endl;
+            return 1;
+        }
+        evaluator = &neuralEvaluator;
+    }
+
+    DatasetWriter writer;
+    if (!openDatasetWriter(writer, path))
+    {
+        std::cerr << "Could not create " << path << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Game game;
+    for (int g = 0; g < games; ++g)
+    {
+        resetGame(game, seed + g);
+        while (!game.isGameOver && game.piecesPlaced < maxPieces)
+        {
+            Placement placement;
+            if (!choosePlacement(game, *evaluator, placement))
+                break;
+
+            DatasetRecord record;
+            record.board = game.board;
+            record.pieceType = (uint8_t)game.current.type;
+            for (int i = 0; i < NEXT_QUEUE_SIZE; ++i)
+                record.queue[i] = (uint8_t)game.queue[i];
+            record.action = (uint8_t)(placement.rotation * BOARD_WIDTH + placement.x);
+            record.linesCleared = (uint8_t)applyPlacement(game, placement);
+            record.isGameOver = game.isGameOver || game.piecesPlaced >= maxPieces;
+            if (!writeDatasetRecord(writer, record))
+            {
+                std::cerr << "Could not write to " << path << std::endl;
+                closeDatasetWriter(writer);
+                return 1;
+            }
+        }
+    }
+
+    uint64_t records = writer.header.recordCount;
+    if (!closeDatasetWriter(writer))
+    {
+        std::cerr << "Could not finish writing " << path << std::endl;
+        return 1;
+    }
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Read everything back through the mapped file to validate the chunks
+    start = std::chrono::steady_clock::now();
+    DatasetReader reader;
+    if (!openDatasetReader(reader, path))
+    {
+        std::cerr << "Could not read back " << path << std::endl;
+        return 1;
+    }
+    uint64_t decoded = 0;
+    std::vector<DatasetRecord> chunk;
+    for (uint32_t i = 0; i < reader.header->chunkCount; ++i)
+    {
+        if (!decodeDatasetChunk(reader, i, chunk))
+        {
+            std::cerr << "Chunk " << i << " is corrupt" << std::endl;
+            return 1;
+        }
+        decoded += chunk.size();
+    }
+    size_t fileBytes = reader.file.size;
+    closeDatasetReader(reader);
+    double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (decoded != records)
+    {
+        std::cerr << "Decoded " << decoded << " records, expected " << records << std::endl;
+        return 1;
+    }
+
+    double bytesPerRecord = records ? (double)fileBytes / records : 0.0;
+    std::cout << "records: " << records << std::endl;
+    std::cout << "file bytes: " << fileBytes << " (" << bytesPerRecord << " per record)" << std::endl;
+    std::cout << "vs int grid: " << (bytesPerRecord > 0 ? NAIVE_RECORD_BYTES / bytesPerRecord : 0.0) << "x smaller" << std::endl;
+    std::cout << "self-play: " << writeSeconds << " s, decode: " << readSeconds << " s" << std::endl;
+    return 0;
+}
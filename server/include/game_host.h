@@ -0,0 +1,104 @@
+#pragma once
+
+#include "game.h"
+#include "net_protocol.h"
+#include "pathfinder.h"
+#include "spsc_queue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Server-authoritative host for many games at once. Sessions are split across shards, each a
+// worker thread pinned to one core that steps every session it owns on a fixed tick. Sessions
+// move between shards through single-producer/single-consumer queues owned by the coordinator,
+// the thread that creates the host and calls forwardDepartures and rebalanceShards.
+
+const int HOST_TICK_RATE = 60;
+const int SHARD_QUEUE_CAPACITY = 16384;
+const float REBALANCE_THRESHOLD = 1.2f; // Hottest shard load against the mean before sessions move
+const float REBALANCE_MIN_LOAD = 0.5f;  // Below this much of a tick every shard keeps up, so nothing moves
+const int SNAPSHOT_WORDS = NET_STATE_SIZE / 8;
+
+enum SlotState
+{
+    SLOT_FREE,
+    SLOT_ACTIVE,
+    SLOT_CLOSING,
+};
+
+// Per session data any thread may touch; stays put while the session moves between shards
+struct SessionSlot
+{
+    std::atomic<uint8_t> state;
+    std::atomic<uint8_t> inputs; // Bit m set for each Move m received since the last tick
+    std::atomic<uint16_t> inputSequence; // Sequence of the latest input message
+    std::atomic<uint32_t> shard;
+    std::atomic<uint32_t> tick; // Last tick the session was stepped on
+
+    // NET_STATE message as of the last change, published by the shard under a sequence lock:
+    // snapshotVersion is odd while the words are being written
+    std::atomic<uint32_t> snapshotVersion;
+    std::atomic<uint64_t> snapshot[SNAPSHOT_WORDS];
+};
+
+// Everything the simulation needs, kept small so a shard walks its sessions in one pass
+struct Session
+{
+    uint32_t id;
+    int gravityTicks;
+    uint64_t checksum; // Rolled every tick, sent with each state
+    Game game;
+};
+
+struct ShardMetrics
+{
+    std::atomic<uint32_t> sessions;
+    std::atomic<float> load;  // Smoothed busy time as a fraction of the tick
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> overruns; // Ticks whose work did not fit in the tick
+    std::atomic<uint64_t> arrivals; // New and migrated sessions adopted
+    std::atomic<uint64_t> evictions;
+};
+
+struct Shard
+{
+    int index;
+    std::thread thread;
+    std::vector<Session> sessions; // Run queue, stepped in order every tick; shard thread only
+    SpscQueue<Session, SHARD_QUEUE_CAPACITY> arrivals;   // Coordinator to shard
+    SpscQueue<Session, SHARD_QUEUE_CAPACITY> departures; // Shard to coordinator
+    std::atomic<uint32_t> evictCount; // Sessions the coordinator wants moved elsewhere
+    ShardMetrics metrics;
+};
+
+struct GameHost
+{
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<SessionSlot[]> slots;
+    int maxSessions;
+    uint32_t nextSlot; // Coordinator only
+    std::vector<Session> backlog; // Sessions between shards that no arrival queue had room for yet; coordinator only
+    uint64_t arrivalFailures; // Sessions no arrival queue had room for, counted on every attempt; coordinator only
+    std::atomic<bool> isRunning;
+};
+
+bool startGameHost(GameHost& host, int shardCount, int maxSessions);
+void stopGameHost(GameHost& host);
+
+// Coordinator side. createSession returns the session id, or -1 if the host is full or busy.
+int createSession(GameHost& host, uint64_t seed);
+void closeSession(GameHost& host, int id);
+// Hands the sessions shards gave up to the coolest shard and returns how many moved. A moving session
+// is not stepped until it arrives, so call this every tick. Sessions that find no room wait in the
+// backlog and are offered again on the next call.
+int forwardDepartures(GameHost& host);
+// Call about once a second; asks the hottest shard to give up sessions and returns how many
+int rebalanceShards(GameHost& host);
+
+// Any thread
+void sendInput(GameHost& host, int id, Move move);
+void sendInputs(GameHost& host, int id, uint8_t moves, uint16_t sequence);
+
+// Copies the latest published state; false if it has not changed since knownVersion
+bool readSessionSnapshot(const GameHost& host, int id, uint32_t knownVersion, uint8_t* bytes, uint32_t& version);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "game_host.h"
+#include "replication.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Non-blocking TCP and UDP front end for a GameHost, driven from one thread with epoll. Linux only, built
+// by the CMakeLists.txt at the top of the tree; elsewhere startNetServer fails and the server can only bench.
+// Every connection gets fixed buffers up front; reads parse NET_HELLO and NET_INPUT messages straight
+// out of them, and flushes send each changed session's NET_STATE with writev for TCP streams and
+// sendmmsg batches for UDP peers. Spectators of a session share one channel: each change is encoded
+// once as a replication frame and the same bytes go to every viewer, so a viewer costs a copy into
+// its ring (TCP) or one more datagram pointing at the shared frame (UDP).
+
+const int NET_INPUT_BUFFER_SIZE = 64;
+const int NET_OUTPUT_BUFFER_SIZE = 1024; // Ring of 14 states; a slow TCP reader skips states rather than growing it
+const int NET_UDP_BATCH = 64;            // Datagrams per recvmmsg and sendmmsg call
+const int NET_UDP_TIMEOUT_MILLISECONDS = 10000;
+
+struct NetConnection
+{
+    int fd; // -1 for a free connection; UDP peers share the server's socket
+    bool isUdp;
+    uint32_t address; // UDP peer, network byte order
+    uint16_t port;
+    int sessionId; // -1 until NET_HELLO
+    int watchedSessionId; // -1 unless NET_SPECTATE; a connection either plays or watches
+    uint32_t sentVersion; // Snapshot version last queued for sending
+    int64_t lastHeardMilliseconds;
+
+    uint8_t input[NET_INPUT_BUFFER_SIZE];
+    int inputSize;
+    uint8_t output[NET_OUTPUT_BUFFER_SIZE];
+    uint32_t outputHead, outputTail; // Free-running; tail - head bytes are waiting to be sent
+};
+
+struct NetStats
+{
+    uint64_t connections;
+    uint64_t messagesIn;
+    uint64_t messagesOut;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t sendCalls;
+    uint64_t statesSkipped; // Dropped because a TCP client was not keeping up
+    uint64_t framesEncoded; // Replication frames, once per change of a watched session
+    uint64_t framesSent;    // The same frames counted once per spectator
+};
+
+// Everyone watching one session
+struct SpectatorChannel
+{
+    ReplicationEncoder encoder;
+    uint32_t sentVersion; // Snapshot version last encoded
+    std::vector<int> spectators; // Connection indices
+    uint8_t frame[REPLICATION_MAX_FRAME]; // Stays valid until the next flush, UDP batches point into it
+    int frameSize;
+};
+
+struct NetBatch; // sendmmsg/recvmmsg scratch, defined with the socket code
+
+struct NetServer
+{
+    GameHost* host;
+    int epollFd;
+    int listenFd;
+    int udpFd;
+    NetConnection* connections;
+    int maxConnections;
+    std::vector<int> freeConnections;
+    std::unordered_map<uint64_t, int> udpPeers; // (address << 16 | port) to connection
+    std::unordered_map<int, SpectatorChannel> channels; // Watched session id to its spectators
+    NetBatch* batch;
+    NetStats stats;
+};
+
+bool startNetServer(NetServer& server, GameHost& host, uint16_t port, int maxConnections);
+void stopNetServer(NetServer& server);
+
+// Accepts, reads and handles input until timeoutMilliseconds passes without anything to do
+void pollNetServer(NetServer& server, int timeoutMilliseconds);
+
+// Queues the state of every session that changed, encodes one replication frame per watched
+// session that changed and sends everything pending
+void flushNetServer(NetServer& server);
@@ -0,0 +1,347 @@
+#include "game_host.h"
+#include "checksum.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static void pinThread(std::thread& thread, int core)
+{
+#if defined(_WIN32)
+    SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1 << (core % 64));
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core % CPU_SETSIZE, &cpus);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#endif
+}
+
+static void publishSnapshot(SessionSlot& slot, const Session& session, uint64_t tick, uint16_t ackedSequence)
+{
+    alignas(8) uint8_t bytes[NET_STATE_SIZE];
+    writeStateMessage(bytes, session.game, (uint32_t)tick, ackedSequence, session.checksum);
+
+    uint32_t version = slot.snapshotVersion.load(std::memory_order_relaxed);
+    slot.snapshotVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < SNAPSHOT_WORDS; ++i)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i * 8, sizeof(word));
+        slot.snapshot[i].store(word, std::memory_order_relaxed);
+    }
+    slot.snapshotVersion.store(version + 2, std::memory_order_release);
+}
+
+static void stepSession(GameHost& host, Session& session, uint64_t tick)
+{
+    SessionSlot& slot = host.slots[session.id];
+    uint8_t inputs = slot.inputs.exchange(0, std::memory_order_acquire);
+    slot.tick.store((uint32_t)tick, std::memory_order_relaxed);
+
+    // Clients only hear about ticks that changed something, plus the first one
+    bool isChanged = slot.snapshotVersion.load(std::memory_order_relaxed) == 0;
+    isChanged |= stepGame(session.game, inputs, session.gravityTicks);
+    session.checksum = rollChecksum(session.checksum, session.game);
+
+    if (isChanged || inputs != 0)
+        publishSnapshot(slot, session, tick, slot.inputSequence.load(std::memory_order_relaxed));
+}
+
+// Adopts arrivals, hands evicted and closed sessions back, then steps the rest
+static void runShardTick(GameHost& host, Shard& shard, uint64_t tick)
+{
+    Session session;
+    while (shard.arrivals.pop(session))
+    {
+        host.slots[session.id].shard.store(shard.index, std::memory_order_relaxed);
+        shard.sessions.push_back(session);
+        shard.metrics.arrivals.fetch_add(1, std::memory_order_relaxed);
+    }
+    shard.metrics.sessions.store((uint32_t)shard.sessions.size(), std::memory_order_relaxed);
+
+    uint32_t evictions = shard.evictCount.exchange(0, std::memory_order_relaxed);
+    while (evictions > 0 && !shard.sessions.empty() && shard.departures.push(shard.sessions.back()))
+    {
+        shard.sessions.pop_back();
+        shard.metrics.evictions.fetch_add(1, std::memory_order_relaxed);
+        --evictions;
+    }
+
+    for (size_t i = 0; i < shard.sessions.size();)
+    {
+        SessionSlot& slot = host.slots[shard.sessions[i].id];
+        if (slot.state.load(std::memory_order_acquire) == SLOT_CLOSING)
+        {
+            // Order in the run queue does not matter, so close by swapping with the last one
+            shard.sessions[i] = shard.sessions.back();
+            shard.sessions.pop_back();
+            slot.state.store(SLOT_FREE, std::memory_order_release);
+            continue;
+        }
+        stepSession(host, shard.sessions[i], tick);
+        ++i;
+    }
+    shard.metrics.sessions.store((uint32_t)shard.sessions.size(), std::memory_order_relaxed);
+}
+
+static void runShard(GameHost& host, Shard& shard)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto tickPeriod = std::chrono::microseconds(1000000 / HOST_TICK_RATE);
+    auto nextTick = Clock::now();
+    uint64_t tick = 0;
+    float load = 0.0f;
+
+    while (host.isRunning.load(std::memory_order_relaxed))
+    {
+        auto start = Clock::now();
+        runShardTick(host, shard, tick++);
+        auto busy = Clock::now() - start;
+
+        float tickLoad = std::chrono::duration<float>(busy).count() / std::chrono::duration<float>(tickPeriod).count();
+        load = load * 0.9f + tickLoad * 0.1f;
+        shard.metrics.load.store(load, std::memory_order_relaxed);
+        shard.metrics.ticks.fetch_add(1, std::memory_order_relaxed);
+
+        // Fixed tick: fall behind rather than speed up, and never try to catch up with a burst
+        nextTick += tickPeriod;
+        if (busy > tickPeriod || Clock::now() > nextTick)
+        {
+            shard.metrics.overruns.fetch_add(1, std::memory_order_relaxed);
+            nextTick = Clock::now();
+        }
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+bool startGameHost(GameHost& host, int shardCount, int maxSessions)
+{
+    if (shardCount < 1 || maxSessions < 1)
+        return false;
+
+    host.maxSessions = maxSessions;
+    host.nextSlot = 0;
+    host.backlog.clear();
+    host.arrivalFailures = 0;
+    host.slots.reset(new SessionSlot[maxSessions]);
+    for (int i = 0; i < maxSessions; ++i)
+    {
+        host.slots[i].state = SLOT_FREE;
+        host.slots[i].inputs = 0;
+        host.slots[i].shard = 0;
+        host.slots[i].tick = 0;
+        host.slots[i].inputSequence = 0;
+        host.slots[i].snapshotVersion = 0;
+    }
+
+    host.isRunning = true;
+    host.shards.clear();
+    for (int i = 0; i < shardCount; ++i)
+    {
+        host.shards.emplace_back(new Shard);
+        Shard& shard = *host.shards.back();
+        shard.index = i;
+        shard.sessions.reserve(maxSessions / shardCount + 1);
+        shard.evictCount = 0;
+        shard.metrics.sessions = 0;
+        shard.metrics.load = 0.0f;
+        shard.metrics.ticks = 0;
+        shard.metrics.overruns = 0;
+        shard.metrics.arrivals = 0;
+        shard.metrics.evictions = 0;
+    }
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        shard->thread = std::thread(runShard, std::ref(host), std::ref(*shard));
+        pinThread(shard->thread, shard->index);
+    }
+    return true;
+}
+
+void stopGameHost(GameHost& host)
+{
+    host.isRunning = false;
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        if (shard->thread.joinable())
+            shard->thread.join();
+    }
+    host.shards.clear();
+}
+
+// Counts sessions still waiting in the arrival queue so a burst of creates spreads out
+static Shard& getEmptiestShard(GameHost& host)
+{
+    Shard* emptiest = host.shards[0].get();
+    size_t emptiestSize = SIZE_MAX;
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        size_t size = shard->metrics.sessions.load(std::memory_order_relaxed)
+            + (shard->arrivals.tail.load(std::memory_order_relaxed) - shard->arrivals.head.load(std::memory_order_relaxed));
+        if (size < emptiestSize)
+        {
+            emptiest = shard.get();
+            emptiestSize = size;
+        }
+    }
+    return *emptiest;
+}
+
+int createSession(GameHost& host, uint64_t seed)
+{
+    for (int probe = 0; probe < host.maxSessions; ++probe)
+    {
+        uint32_t id = host.nextSlot;
+        host.nextSlot = (host.nextSlot + 1) % host.maxSessions;
+        SessionSlot& slot = host.slots[id];
+        if (slot.state.load(std::memory_order_acquire) != SLOT_FREE)
+            continue;
+
+        Session session;
+        session.id = id;
+        session.gravityTicks = 0;
+        session.checksum = 0;
+        resetGame(session.game, seed);
+
+        slot.inputs.store(0, std::memory_order_relaxed);
+        slot.inputSequence.store(0, std::memory_order_relaxed);
+        slot.snapshotVersion.store(0, std::memory_order_relaxed);
+        slot.state.store(SLOT_ACTIVE, std::memory_order_release);
+        Shard& shard = getEmptiestShard(host);
+        if (!shard.arrivals.push(session))
+        {
+            slot.state.store(SLOT_FREE, std::memory_order_release);
+            return -1;
+        }
+        return (int)id;
+    }
+    return -1;
+}
+
+void closeSession(GameHost& host, int id)
+{
+    uint8_t expected = SLOT_ACTIVE;
+    host.slots[id].state.compare_exchange_strong(expected, SLOT_CLOSING, std::memory_order_acq_rel);
+}
+
+void sendInput(GameHost& host, int id, Move move)
+{
+    host.slots[id].inputs.fetch_or((uint8_t)(1 << move), std::memory_order_release);
+}
+
+void sendInputs(GameHost& host, int id, uint8_t moves, uint16_t sequence)
+{
+    SessionSlot& slot = host.slots[id];
+    slot.inputSequence.store(sequence, std::memory_order_relaxed);
+    slot.inputs.fetch_or((uint8_t)(moves & ((1 << MOVE_COUNT) - 1)), std::memory_order_release);
+}
+
+bool readSessionSnapshot(const GameHost& host, int id, uint32_t knownVersion, uint8_t* bytes, uint32_t& version)
+{
+    const SessionSlot& slot = host.slots[id];
+    for (;;)
+    {
+        version = slot.snapshotVersion.load(std::memory_order_acquire);
+        if (version == knownVersion)
+            return false;
+        if (version & 1)
+            continue; // The shard is halfway through writing
+
+        for (int i = 0; i < SNAPSHOT_WORDS; ++i)
+        {
+            uint64_t word = slot.snapshot[i].load(std::memory_order_relaxed);
+            memcpy(bytes + i * 8, &word, sizeof(word));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.snapshotVersion.load(std::memory_order_relaxed) == version)
+            return true;
+    }
+}
+
+static Shard* findCoolestShard(GameHost& host)
+{
+    Shard* coolest = host.shards[0].get();
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        if (shard->metrics.load.load(std::memory_order_relaxed) < coolest->metrics.load.load(std::memory_order_relaxed))
+            coolest = shard.get();
+    }
+    return coolest;
+}
+
+int forwardDepartures(GameHost& host)
+{
+    Session session;
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        while (shard->departures.pop(session))
+            host.backlog.push_back(session);
+    }
+    if (host.backlog.empty())
+        return 0;
+
+    // An arrival queue only fills up if its shard stopped ticking, so try the others before giving up
+    // until next time. Whatever stays behind is held here, where nothing can lose it.
+    Shard* coolest = findCoolestShard(host);
+    int moved = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < host.backlog.size(); ++i)
+    {
+        Session& waiting = host.backlog[i];
+        SessionSlot& slot = host.slots[waiting.id];
+        if (slot.state.load(std::memory_order_acquire) == SLOT_CLOSING)
+        {
+            slot.state.store(SLOT_FREE, std::memory_order_release);
+            continue;
+        }
+
+        bool isPushed = coolest->arrivals.push(waiting);
+        for (size_t s = 0; s < host.shards.size() && !isPushed; ++s)
+            isPushed = host.shards[s].get() != coolest && host.shards[s]->arrivals.push(waiting);
+        if (isPushed)
+        {
+            ++moved;
+            continue;
+        }
+        host.backlog[kept++] = waiting;
+        ++host.arrivalFailures;
+    }
+    host.backlog.resize(kept);
+    return moved;
+}
+
+int rebalanceShards(GameHost& host)
+{
+    Shard* coolest = findCoolestShard(host);
+    float totalLoad = 0.0f;
+    Shard* hottest = coolest;
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        float load = shard->metrics.load.load(std::memory_order_relaxed);
+        totalLoad += load;
+        if (load > hottest->metrics.load.load(std::memory_order_relaxed))
+            hottest = shard.get();
+    }
+
+    // Ask the hottest shard to shed half of its excess over the mean, measured in sessions
+    float meanLoad = totalLoad / host.shards.size();
+    float hottestLoad = hottest->metrics.load.load(std::memory_order_relaxed);
+    if (hottest == coolest || hottestLoad <= REBALANCE_MIN_LOAD || hottestLoad <= meanLoad * REBALANCE_THRESHOLD
+        || hottest->evictCount.load(std::memory_order_relaxed) != 0)
+        return 0;
+
+    uint32_t sessions = hottest->metrics.sessions.load(std::memory_order_relaxed);
+    uint32_t excess = (uint32_t)(sessions * (hottestLoad - meanLoad) / hottestLoad / 2.0f);
+    uint32_t evictions = excess < SHARD_QUEUE_CAPACITY ? excess : SHARD_QUEUE_CAPACITY;
+    hottest->evictCount.store(evictions, std::memory_order_relaxed);
+    return (int)evictions;
+}
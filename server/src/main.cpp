@@ -0,0 +1,155 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "game_host.h"
+#include "net_server.h"
+
+const char* USAGE =
+    "Usage: server serve [port=7777] [shards=cores] [maxSessions=100000]\n"
+    "       server bench [sessions=100000] [shards=cores] [seconds=10] [busyPercent=20]";
+
+static void printShardMetrics(GameHost& host)
+{
+    for (std::unique_ptr<Shard>& shard : host.shards)
+    {
+        printf("shard %d: %u sessions, load %.2f, ticks %llu, overruns %llu, arrivals %llu, evictions %llu\n", shard->index,
+            shard->metrics.sessions.load(), shard->metrics.load.load(),
+            (unsigned long long)shard->metrics.ticks.load(), (unsigned long long)shard->metrics.overruns.load(),
+            (unsigned long long)shard->metrics.arrivals.load(), (unsigned long long)shard->metrics.evictions.load());
+    }
+    printf("backlog: %zu sessions waiting for a shard, %llu failed arrivals\n", host.backlog.size(), (unsigned long long)host.arrivalFailures);
+}
+
+// Serves clients over the network until killed; the network runs on this thread at the host tick rate
+static int serve(int argc, char* argv[])
+{
+    uint16_t port = (uint16_t)(argc > 2 ? atoi(argv[2]) : 7777);
+    int shardCount = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    int maxSessions = argc > 4 ? atoi(argv[4]) : 100000;
+
+    GameHost host;
+    if (!startGameHost(host, shardCount > 0 ? shardCount : 1, maxSessions))
+    {
+        std::cerr << "Could not start the host" << std::endl;
+        return 1;
+    }
+    NetServer server;
+    if (!startNetServer(server, host, port, maxSessions))
+    {
+        std::cerr << "Could not listen on port " << port << std::endl;
+        stopGameHost(host);
+        return 1;
+    }
+    std::cout << "listening on port " << port << " (tcp and udp)" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    const auto tickPeriod = std::chrono::microseconds(1000000 / HOST_TICK_RATE);
+    auto nextFlush = Clock::now() + tickPeriod;
+    auto nextReport = Clock::now() + std::chrono::seconds(1);
+    for (;;)
+    {
+        int timeout = (int)std::chrono::duration_cast<std::chrono::milliseconds>(nextFlush - Clock::now()).count();
+        pollNetServer(server, timeout > 0 ? timeout : 0);
+        if (Clock::now() < nextFlush)
+            continue;
+
+        flushNetServer(server);
+        forwardDepartures(host);
+        nextFlush += tickPeriod;
+        if (Clock::now() >= nextReport)
+        {
+            rebalanceShards(host);
+            printShardMetrics(host);
+            const NetStats& stats = server.stats;
+            printf("net: %llu connections, in %llu msgs / %llu bytes, out %llu msgs / %llu bytes in %llu sends, %llu skipped\n",
+                (unsigned long long)stats.connections, (unsigned long long)stats.messagesIn, (unsigned long long)stats.bytesIn,
+                (unsigned long long)stats.messagesOut, (unsigned long long)stats.bytesOut, (unsigned long long)stats.sendCalls,
+                (unsigned long long)stats.statesSkipped);
+            fflush(stdout);
+            nextReport += std::chrono::seconds(1);
+        }
+    }
+}
+
+// Headless load run: fills the host with sessions, plays a random input stream for a busy subset
+// of them and prints per-shard metrics once a second while rebalancing
+static int bench(int argc, char* argv[])
+{
+    int sessionCount = argc > 2 ? atoi(argv[2]) : 100000;
+    int shardCount = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    int busyPercent = argc > 5 ? atoi(argv[5]) : 20;
+    if (sessionCount < 1 || shardCount < 1 || seconds < 1)
+    {
+        std::cerr << USAGE << std::endl;
+        return 1;
+    }
+
+    GameHost host;
+    if (!startGameHost(host, shardCount, sessionCount))
+    {
+        std::cerr << "Could not start the host" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> ids;
+    ids.reserve(sessionCount);
+    while ((int)ids.size() < sessionCount)
+    {
+        int id = createSession(host, ids.size() + 1);
+        if (id >= 0)
+            ids.push_back(id);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double createSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "created " << ids.size() << " sessions on " << shardCount << " shards in " << createSeconds << " s" << std::endl;
+
+    // The busy players all start on the same shards, which is what rebalancing has to fix
+    std::vector<int> busy;
+    for (int id : ids)
+    {
+        if ((int)host.slots[id].shard.load() < (shardCount + 1) / 2 && (int)(busy.size() * 100) < sessionCount * busyPercent)
+            busy.push_back(id);
+    }
+
+    Rng rng;
+    seedRng(rng, 1);
+    auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    int moved = 0;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        for (int id : busy)
+            sendInput(host, id, (Move)(nextRandom(rng) % MOVE_HARD_DROP));
+        moved += forwardDepartures(host);
+
+        if (std::chrono::steady_clock::now() >= nextReport)
+        {
+            rebalanceShards(host);
+            printShardMetrics(host);
+            printf("moved %d sessions\n", moved);
+            nextReport += std::chrono::seconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / HOST_TICK_RATE));
+    }
+
+    stopGameHost(host);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "serve") == 0)
+        return serve(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench(argc, argv);
+
+    std::cerr << USAGE << std::endl;
+    return 1;
+}
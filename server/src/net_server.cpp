@@ -0,0 +1,565 @@
+#include "net_server.h"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+const uint64_t LISTEN_TOKEN = ~0ull;
+const uint64_t UDP_TOKEN = ~0ull - 1;
+const int EPOLL_BATCH = 256;
+
+struct NetBatch
+{
+    // Outgoing datagrams waiting for the next sendmmsg
+    mmsghdr headers[NET_UDP_BATCH];
+    iovec vectors[NET_UDP_BATCH];
+    sockaddr_in addresses[NET_UDP_BATCH];
+    uint8_t payloads[NET_UDP_BATCH][NET_MAX_MESSAGE_SIZE * 4];
+    int count;
+
+    // Incoming datagrams of one recvmmsg
+    mmsghdr receivedHeaders[NET_UDP_BATCH];
+    iovec receivedVectors[NET_UDP_BATCH];
+    sockaddr_in receivedAddresses[NET_UDP_BATCH];
+    uint8_t received[NET_UDP_BATCH][NET_INPUT_BUFFER_SIZE];
+};
+
+static int64_t getMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t getPeerKey(uint32_t address, uint16_t port)
+{
+    return ((uint64_t)address << 16) | port;
+}
+
+static int allocateConnection(NetServer& server)
+{
+    if (server.freeConnections.empty())
+        return -1;
+
+    int index = server.freeConnections.back();
+    server.freeConnections.pop_back();
+    NetConnection& connection = server.connections[index];
+    connection.isUdp = false;
+    connection.address = 0;
+    connection.port = 0;
+    connection.sessionId = -1;
+    connection.watchedSessionId = -1;
+    connection.sentVersion = 0;
+    connection.lastHeardMilliseconds = getMilliseconds();
+    connection.inputSize = 0;
+    connection.outputHead = connection.outputTail = 0;
+    ++server.stats.connections;
+    return index;
+}
+
+static void closeConnection(NetServer& server, int index)
+{
+    NetConnection& connection = server.connections[index];
+    if (connection.fd < 0)
+        return;
+
+    if (connection.sessionId >= 0)
+        closeSession(*server.host, connection.sessionId);
+    if (connection.watchedSessionId >= 0)
+    {
+        // Empty channels are dropped by the next flush, never while a UDP batch may point into them
+        std::vector<int>& spectators = server.channels[connection.watchedSessionId].spectators;
+        auto spectator = std::find(spectators.begin(), spectators.end(), index);
+        if (spectator != spectators.end())
+        {
+            *spectator = spectators.back();
+            spectators.pop_back();
+        }
+    }
+    if (connection.isUdp)
+        server.udpPeers.erase(getPeerKey(connection.address, connection.port));
+    else
+        close(connection.fd); // Also removes it from the epoll set
+    connection.fd = -1;
+    server.freeConnections.push_back(index);
+}
+
+static bool queueOutput(NetConnection& connection, const uint8_t* bytes, int size)
+{
+    if (NET_OUTPUT_BUFFER_SIZE - (connection.outputTail - connection.outputHead) < (uint32_t)size)
+        return false;
+
+    for (int i = 0; i < size; ++i)
+        connection.output[(connection.outputTail + i) % NET_OUTPUT_BUFFER_SIZE] = bytes[i];
+    connection.outputTail += size;
+    return true;
+}
+
+// Handles every whole message in bytes and returns how many bytes that was; -1 on a protocol error
+static int handleMessages(NetServer& server, int index, const uint8_t* bytes, int size, uint8_t* reply, int& replySize)
+{
+    NetConnection& connection = server.connections[index];
+    int offset = 0;
+    while (offset < size)
+    {
+        int messageSize = getNetMessageSize(bytes[offset]);
+        if (messageSize == 0)
+            return -1;
+        if (size - offset < messageSize)
+            break;
+
+        const uint8_t* message = bytes + offset;
+        if (message[0] == NET_HELLO && connection.sessionId < 0)
+        {
+            if (message[1] != NET_PROTOCOL_VERSION)
+                return -1;
+            connection.sessionId = createSession(*server.host, readU32(message + 4));
+            if (connection.sessionId < 0)
+                return -1;
+            writeWelcomeMessage(reply + replySize, (uint32_t)connection.sessionId);
+            replySize += NET_WELCOME_SIZE;
+        }
+        else if (message[0] == NET_INPUT && connection.sessionId >= 0)
+        {
+            sendInputs(*server.host, connection.sessionId, message[1], readU16(message + 2));
+        }
+        else if (message[0] == NET_SPECTATE && connection.sessionId < 0 && connection.watchedSessionId == (int)readU32(message + 4))
+        {
+            // UDP spectators repeat the request to stay alive; they resync on the next periodic keyframe
+        }
+        else if (message[0] == NET_SPECTATE && connection.sessionId < 0 && connection.watchedSessionId < 0)
+        {
+            uint32_t watchedId = readU32(message + 4);
+            if (message[1] != NET_PROTOCOL_VERSION || watchedId >= (uint32_t)server.host->maxSessions)
+                return -1;
+
+            auto channel = server.channels.find(watchedId);
+            if (channel == server.channels.end())
+            {
+                channel = server.channels.emplace((int)watchedId, SpectatorChannel()).first;
+                resetReplicationEncoder(channel->second.encoder);
+                channel->second.frameSize = 0;
+            }
+            // The newcomer needs a keyframe now, even if the game sits still
+            channel->second.encoder.isKeyframeRequested = true;
+            channel->second.sentVersion = 0;
+            channel->second.spectators.push_back(index);
+            connection.watchedSessionId = (int)watchedId;
+        }
+        else
+        {
+            return -1;
+        }
+
+        offset += messageSize;
+        ++server.stats.messagesIn;
+    }
+    return offset;
+}
+
+static void acceptConnections(NetServer& server)
+{
+    for (;;)
+    {
+        int fd = accept4(server.listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        int index = allocateConnection(server);
+        if (index < 0)
+        {
+            close(fd);
+            continue;
+        }
+
+        // Inputs and states are tiny and latency sensitive
+        int isEnabled = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &isEnabled, sizeof(isEnabled));
+        server.connections[index].fd = fd;
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = (uint64_t)index;
+        epoll_ctl(server.epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+static void readStream(NetServer& server, int index)
+{
+    NetConnection& connection = server.connections[index];
+    for (;;)
+    {
+        ssize_t received = recv(connection.fd, connection.input + connection.inputSize, NET_INPUT_BUFFER_SIZE - connection.inputSize, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            closeConnection(server, index);
+            return;
+        }
+        if (received < 0)
+            return;
+
+        server.stats.bytesIn += received;
+        connection.inputSize += (int)received;
+
+        uint8_t reply[NET_WELCOME_SIZE * (NET_INPUT_BUFFER_SIZE / NET_INPUT_SIZE)];
+        int replySize = 0;
+        int consumed = handleMessages(server, index, connection.input, connection.inputSize, reply, replySize);
+        if (consumed < 0 || (replySize > 0 && !queueOutput(connection, reply, replySize)))
+        {
+            closeConnection(server, index);
+            return;
+        }
+
+        // Keep the partial message at the front for the next read
+        connection.inputSize -= consumed;
+        memmove(connection.input, connection.input + consumed, connection.inputSize);
+    }
+}
+
+static void flushUdpBatch(NetServer& server)
+{
+    NetBatch& batch = *server.batch;
+    int sent = 0;
+    while (sent < batch.count)
+    {
+        int result = sendmmsg(server.udpFd, batch.headers + sent, batch.count - sent, 0);
+        ++server.stats.sendCalls;
+        if (result <= 0)
+            break; // Datagrams may be lost anyway; the next state replaces them
+        for (int i = sent; i < sent + result; ++i)
+            server.stats.bytesOut += batch.headers[i].msg_len;
+        sent += result;
+    }
+    batch.count = 0;
+}
+
+// Adds a datagram for the peer to the outgoing batch without copying it, so bytes must stay put
+// until the batch is sent. Sends the batch when it fills up.
+static void queueSharedDatagram(NetServer& server, const NetConnection& connection, const uint8_t* bytes, int size)
+{
+    NetBatch& batch = *server.batch;
+    int i = batch.count++;
+    batch.addresses[i] = {};
+    batch.addresses[i].sin_family = AF_INET;
+    batch.addresses[i].sin_addr.s_addr = connection.address;
+    batch.addresses[i].sin_port = connection.port;
+    batch.vectors[i] = { (void*)bytes, (size_t)size };
+    batch.headers[i] = {};
+    batch.headers[i].msg_hdr.msg_name = &batch.addresses[i];
+    batch.headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    batch.headers[i].msg_hdr.msg_iov = &batch.vectors[i];
+    batch.headers[i].msg_hdr.msg_iovlen = 1;
+    if (batch.count == NET_UDP_BATCH)
+        flushUdpBatch(server);
+}
+
+// Same, for bytes that do not outlive the call
+static void queueDatagram(NetServer& server, const NetConnection& connection, const uint8_t* bytes, int size)
+{
+    NetBatch& batch = *server.batch;
+    memcpy(batch.payloads[batch.count], bytes, size);
+    queueSharedDatagram(server, connection, batch.payloads[batch.count], size);
+}
+
+static void readDatagrams(NetServer& server)
+{
+    NetBatch& batch = *server.batch;
+    mmsghdr* headers = batch.receivedHeaders;
+    sockaddr_in* addresses = batch.receivedAddresses;
+    uint8_t (*payloads)[NET_INPUT_BUFFER_SIZE] = batch.received;
+
+    for (;;)
+    {
+        for (int i = 0; i < NET_UDP_BATCH; ++i)
+        {
+            batch.receivedVectors[i] = { payloads[i], NET_INPUT_BUFFER_SIZE };
+            headers[i] = {};
+            headers[i].msg_hdr.msg_name = &addresses[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            headers[i].msg_hdr.msg_iov = &batch.receivedVectors[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int count = recvmmsg(server.udpFd, headers, NET_UDP_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0)
+            return;
+
+        for (int i = 0; i < count; ++i)
+        {
+            server.stats.bytesIn += headers[i].msg_len;
+            uint64_t key = getPeerKey(addresses[i].sin_addr.s_addr, addresses[i].sin_port);
+            auto peer = server.udpPeers.find(key);
+            int index;
+            if (peer != server.udpPeers.end())
+            {
+                index = peer->second;
+            }
+            else
+            {
+                // Only a hello or a spectate may open a UDP session
+                if (headers[i].msg_len == 0 || (payloads[i][0] != NET_HELLO && payloads[i][0] != NET_SPECTATE)
+                    || (index = allocateConnection(server)) < 0)
+                    continue;
+                NetConnection& connection = server.connections[index];
+                connection.fd = server.udpFd;
+                connection.isUdp = true;
+                connection.address = addresses[i].sin_addr.s_addr;
+                connection.port = addresses[i].sin_port;
+                server.udpPeers[key] = index;
+            }
+
+            NetConnection& connection = server.connections[index];
+            connection.lastHeardMilliseconds = getMilliseconds();
+            uint8_t reply[NET_WELCOME_SIZE * (NET_INPUT_BUFFER_SIZE / NET_INPUT_SIZE)];
+            int replySize = 0;
+            if (handleMessages(server, index, payloads[i], (int)headers[i].msg_len, reply, replySize) < 0)
+            {
+                closeConnection(server, index);
+                continue;
+            }
+            if (replySize > 0)
+                queueDatagram(server, connection, reply, replySize);
+        }
+    }
+}
+
+bool startNetServer(NetServer& server, GameHost& host, uint16_t port, int maxConnections)
+{
+    // Every TCP player is a file descriptor
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    server.host = &host;
+    server.maxConnections = maxConnections;
+    server.connections = new NetConnection[maxConnections];
+    server.freeConnections.clear();
+    for (int i = maxConnections - 1; i >= 0; --i)
+    {
+        server.connections[i].fd = -1;
+        server.freeConnections.push_back(i);
+    }
+    server.udpPeers.clear();
+    server.udpPeers.reserve(maxConnections);
+    server.channels.clear();
+    server.batch = new NetBatch;
+    server.batch->count = 0;
+    server.stats = {};
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    int isEnabled = 1;
+
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    server.listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    server.udpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server.epollFd < 0 || server.listenFd < 0 || server.udpFd < 0)
+    {
+        stopNetServer(server);
+        return false;
+    }
+    setsockopt(server.listenFd, SOL_SOCKET, SO_REUSEADDR, &isEnabled, sizeof(isEnabled));
+    if (bind(server.listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(server.listenFd, SOMAXCONN) < 0
+        || bind(server.udpFd, (sockaddr*)&address, sizeof(address)) < 0)
+    {
+        stopNetServer(server);
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TOKEN;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.listenFd, &event);
+    event.data.u64 = UDP_TOKEN;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.udpFd, &event);
+    return true;
+}
+
+void stopNetServer(NetServer& server)
+{
+    if (server.connections != nullptr)
+    {
+        for (int i = 0; i < server.maxConnections; ++i)
+            closeConnection(server, i);
+    }
+    if (server.listenFd >= 0)
+        close(server.listenFd);
+    if (server.udpFd >= 0)
+        close(server.udpFd);
+    if (server.epollFd >= 0)
+        close(server.epollFd);
+    server.channels.clear();
+    delete[] server.connections;
+    delete server.batch;
+    server.connections = nullptr;
+    server.batch = nullptr;
+    server.listenFd = server.udpFd = server.epollFd = -1;
+}
+
+void pollNetServer(NetServer& server, int timeoutMilliseconds)
+{
+    epoll_event events[EPOLL_BATCH];
+    int count = epoll_wait(server.epollFd, events, EPOLL_BATCH, timeoutMilliseconds);
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t token = events[i].data.u64;
+        if (token == LISTEN_TOKEN)
+            acceptConnections(server);
+        else if (token == UDP_TOKEN)
+            readDatagrams(server);
+        else if (server.connections[token].fd >= 0)
+        {
+            if (events[i].events & EPOLLIN)
+                readStream(server, (int)token);
+            if ((events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && server.connections[token].fd >= 0)
+                closeConnection(server, (int)token);
+        }
+    }
+}
+
+// Sends as much of the output ring as the socket takes in one writev; the ring wraps, so that is up to two pieces
+static void writeStream(NetServer& server, int index)
+{
+    NetConnection& connection = server.connections[index];
+    uint32_t pending = connection.outputTail - connection.outputHead;
+    if (pending == 0)
+        return;
+
+    uint32_t start = connection.outputHead % NET_OUTPUT_BUFFER_SIZE;
+    uint32_t first = pending < NET_OUTPUT_BUFFER_SIZE - start ? pending : NET_OUTPUT_BUFFER_SIZE - start;
+    iovec vectors[2] = { { connection.output + start, first }, { connection.output, pending - first } };
+    ssize_t written = writev(connection.fd, vectors, pending > first ? 2 : 1);
+    ++server.stats.sendCalls;
+    if (written < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            closeConnection(server, index);
+        return;
+    }
+    connection.outputHead += (uint32_t)written;
+    server.stats.bytesOut += written;
+}
+
+// Encodes each watched session that changed once and hands the same frame to all of its spectators
+static void flushChannels(NetServer& server)
+{
+    for (auto channel = server.channels.begin(); channel != server.channels.end();)
+    {
+        SpectatorChannel& spectated = channel->second;
+        if (spectated.spectators.empty())
+        {
+            channel = server.channels.erase(channel);
+            continue;
+        }
+
+        alignas(8) uint8_t state[NET_STATE_SIZE];
+        uint32_t version;
+        if (readSessionSnapshot(*server.host, channel->first, spectated.sentVersion, state, version))
+        {
+            Game game = {};
+            uint32_t tick;
+            uint16_t ackedSequence;
+            uint64_t checksum;
+            readStateMessage(state, game, tick, ackedSequence, checksum);
+            spectated.frameSize = encodeReplicationFrame(spectated.encoder, game, tick, spectated.frame);
+            spectated.sentVersion = version;
+            ++server.stats.framesEncoded;
+
+            for (int index : spectated.spectators)
+            {
+                NetConnection& connection = server.connections[index];
+                if (connection.isUdp)
+                    queueSharedDatagram(server, connection, spectated.frame, spectated.frameSize);
+                else if (!queueOutput(connection, spectated.frame, spectated.frameSize))
+                {
+                    // The viewer's next delta would not apply, so everyone gets a keyframe next
+                    spectated.encoder.isKeyframeRequested = true;
+                    ++server.stats.statesSkipped;
+                    continue;
+                }
+                ++server.stats.framesSent;
+            }
+        }
+        ++channel;
+    }
+
+    // Frames may be overwritten once every channel is done, so nothing may still point at them
+    flushUdpBatch(server);
+}
+
+void flushNetServer(NetServer& server)
+{
+    flushChannels(server);
+
+    int64_t now = getMilliseconds();
+    for (int i = 0; i < server.maxConnections; ++i)
+    {
+        NetConnection& connection = server.connections[i];
+        if (connection.fd < 0)
+            continue;
+        if (connection.isUdp && now - connection.lastHeardMilliseconds > NET_UDP_TIMEOUT_MILLISECONDS)
+        {
+            closeConnection(server, i);
+            continue;
+        }
+
+        alignas(8) uint8_t state[NET_STATE_SIZE];
+        uint32_t version;
+        if (connection.sessionId >= 0 && readSessionSnapshot(*server.host, connection.sessionId, connection.sentVersion, state, version))
+        {
+            if (connection.isUdp)
+                queueDatagram(server, connection, state, NET_STATE_SIZE);
+            bool isQueued = connection.isUdp || queueOutput(connection, state, NET_STATE_SIZE);
+            if (isQueued)
+            {
+                connection.sentVersion = version;
+                ++server.stats.messagesOut;
+            }
+            else
+            {
+                ++server.stats.statesSkipped;
+            }
+        }
+        if (!connection.isUdp)
+            writeStream(server, i);
+    }
+    flushUdpBatch(server);
+}
+
+#else
+
+bool startNetServer(NetServer& server, GameHost& host, uint16_t port, int maxConnections)
+{
+    server.connections = nullptr;
+    server.batch = nullptr;
+    return false; // The network layer is built on epoll
+}
+
+void stopNetServer(NetServer& server)
+{
+}
+
+void pollNetServer(NetServer& server, int timeoutMilliseconds)
+{
+}
+
+void flushNetServer(NetServer& server)
+{
+}
+
+#endif